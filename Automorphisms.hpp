@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// Every automorphism of a vertex-colored graph, found by individualization and refinement: two colorings of the graph
+// are refined together into equitable partitions (every vertex of a cell sees the same number of neighbors in every
+// cell), then one vertex is singled out in the first and each vertex of the same cell in turn in the second, until the
+// branch vertices are all alone in their cells. Each such pair of colorings that is still consistent pairs up the
+// vertices of one automorphism, which is checked edge by edge. The first coloring follows a single path, so every
+// automorphism is found exactly once. Meant for small groups: the search gives up past a limit.
+class AutomorphismSearch {
+public:
+    using Vertex = std::uint32_t;
+    using Permutation = std::vector<Vertex>;
+
+    // Undirected graph given by the neighbors of every vertex. Automorphisms map every vertex to one of the same color.
+    // The branch vertices are [0, branchVertices); once they are fixed the refinement has to determine the rest up to
+    // vertices with the same neighbors, which are then paired in order.
+    AutomorphismSearch(std::vector<std::vector<Vertex>> neighbors, const std::vector<Vertex> &colors,
+                       std::size_t branchVertices)
+    : m_Neighbors(std::move(neighbors))
+    , m_BranchVertices(branchVertices) {
+        assert(colors.size() == m_Neighbors.size() && branchVertices <= m_Neighbors.size());
+        for (std::vector<Vertex> &adjacent : m_Neighbors) {
+            std::sort(adjacent.begin(), adjacent.end());
+        }
+        m_Colors = colors;
+    }
+
+    // Every automorphism, identity included, or none if there are more than limit.
+    std::vector<Permutation> Run(std::size_t limit) {
+        m_Limit = limit;
+        m_Automorphisms.clear();
+        std::vector<Vertex> a = m_Colors, b = m_Colors;
+        if (Refine(a, b) && !Search(a, b)) {
+            m_Automorphisms.clear();
+        }
+        return std::move(m_Automorphisms);
+    }
+
+    // Calls to Refine(), a measure of the work done by the last Run().
+    std::uint64_t Refinements() const { return m_Refinements; }
+
+private:
+    // Split the cells of both colorings by color and the colors of the neighbors until nothing splits. New colors are
+    // numbered in the order of their signatures, so equal partitions of the two get the same colors. False as soon as
+    // the two disagree on the size of a cell.
+    bool Refine(std::vector<Vertex> &a, std::vector<Vertex> &b) {
+        ++m_Refinements;
+        const std::size_t n = a.size();
+        std::size_t cells = CountCells(a);
+        std::vector<std::vector<Vertex>> signatures(2 * n);
+        std::vector<std::uint64_t> hashes(2 * n);
+        std::vector<Vertex> order(2 * n);
+        for (;;) {
+            // Signatures of a's vertices, then b's: the sorted colors of the neighbors, then the vertex's own color.
+            for (std::size_t i = 0; i < 2 * n; ++i) {
+                const std::vector<Vertex> &coloring = i < n ? a : b;
+                const std::size_t v = i < n ? i : i - n;
+                std::vector<Vertex> &signature = signatures[i];
+                signature.clear();
+                for (Vertex w : m_Neighbors[v]) {
+                    signature.push_back(coloring[w]);
+                }
+                std::sort(signature.begin(), signature.end());
+                signature.push_back(coloring[v]);
+                std::uint64_t h = signature.size();
+                for (Vertex c : signature) {
+                    h = (h ^ c) * 0x9E3779B97F4A7C15ull;
+                    h ^= h >> 29;
+                }
+                hashes[i] = h;
+                order[i] = static_cast<Vertex>(i);
+            }
+            // Sorted by hash, and by the signatures themselves within a hash, so that colors only depend on signatures.
+            std::sort(order.begin(), order.end(), [&](Vertex x, Vertex y) {
+                return hashes[x] != hashes[y] ? hashes[x] < hashes[y] : signatures[x] < signatures[y];
+            });
+            // Every cell has as many vertices of a as of b.
+            Vertex next = 0;
+            std::size_t first = 0, sizeA = 0;
+            for (std::size_t k = 0; k <= order.size(); ++k) {
+                if (k == order.size() || (k > first && (hashes[order[k]] != hashes[order[first]] ||
+                                                       signatures[order[k]] != signatures[order[first]]))) {
+                    if (sizeA * 2 != k - first) {
+                        return false;
+                    }
+                    if (k == order.size()) {
+                        break;
+                    }
+                    ++next;
+                    first = k;
+                    sizeA = 0;
+                }
+                const Vertex i = order[k];
+                sizeA += i < n;
+                (i < n ? a[i] : b[i - n]) = next;
+            }
+            if (next + 1u == cells) {
+                return true;
+            }
+            cells = next + 1u;
+        }
+    }
+
+    static std::size_t CountCells(const std::vector<Vertex> &coloring) {
+        std::vector<Vertex> colors = coloring;
+        std::sort(colors.begin(), colors.end());
+        return static_cast<std::size_t>(std::unique(colors.begin(), colors.end()) - colors.begin());
+    }
+
+    // False once more than m_Limit automorphisms have been found.
+    bool Search(const std::vector<Vertex> &a, const std::vector<Vertex> &b) {
+        // The cell to branch on: the smallest one holding more than one branch vertex, lowest color first.
+        std::vector<std::size_t> sizes(a.size(), 0);
+        for (std::size_t v = 0; v < m_BranchVertices; ++v) {
+            ++sizes[a[v]];
+        }
+        Vertex cell = 0;
+        for (Vertex c = 0; c < sizes.size(); ++c) {
+            if (sizes[c] > 1 && (sizes[cell] <= 1 || sizes[c] < sizes[cell])) {
+                cell = c;
+            }
+        }
+        if (sizes[cell] <= 1) {
+            return Leaf(a, b);
+        }
+
+        const Vertex u = static_cast<Vertex>(std::find(a.begin(), a.end(), cell) - a.begin());
+        const Vertex individual = static_cast<Vertex>(a.size());
+        for (std::size_t v = 0; v < m_BranchVertices; ++v) {
+            if (b[v] != cell) {
+                continue;
+            }
+            std::vector<Vertex> a2 = a, b2 = b;
+            a2[u] = individual;
+            b2[v] = individual;
+            if (Refine(a2, b2) && !Search(a2, b2)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Pair the vertices of a and b by color, in order within a cell, and keep the result if it is an automorphism.
+    bool Leaf(const std::vector<Vertex> &a, const std::vector<Vertex> &b) {
+        std::vector<std::vector<Vertex>> cellsB(a.size());
+        for (std::size_t v = b.size(); v-- > 0;) {
+            cellsB[b[v]].push_back(static_cast<Vertex>(v));
+        }
+        Permutation permutation(a.size());
+        for (std::size_t v = 0; v < a.size(); ++v) {
+            permutation[v] = cellsB[a[v]].back();
+            cellsB[a[v]].pop_back();
+        }
+        for (std::size_t v = 0; v < a.size(); ++v) {
+            if (m_Colors[permutation[v]] != m_Colors[v] ||
+                m_Neighbors[permutation[v]].size() != m_Neighbors[v].size()) {
+                return true;
+            }
+            for (Vertex w : m_Neighbors[v]) {
+                const std::vector<Vertex> &image = m_Neighbors[permutation[v]];
+                if (!std::binary_search(image.begin(), image.end(), permutation[w])) {
+                    return true;
+                }
+            }
+        }
+        m_Automorphisms.push_back(std::move(permutation));
+        return m_Automorphisms.size() <= m_Limit;
+    }
+
+    std::vector<std::vector<Vertex>> m_Neighbors;
+    std::vector<Vertex> m_Colors;
+    std::size_t m_BranchVertices;
+    std::size_t m_Limit = 0;
+    std::uint64_t m_Refinements = 0;
+    std::vector<Permutation> m_Automorphisms;
+};
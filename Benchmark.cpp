@@ -0,0 +1,727 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef __linux__
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif // __linux__
+
+#include "BitsetMatrix.hpp"
+#include "DancingCells.hpp"
+#include "Puzzles.hpp"
+
+namespace {
+
+// Matrix capacities that fit every puzzle below. Small puzzles fit in 16-bit links.
+constexpr std::size_t k_MaxConstraints = 512;
+constexpr std::size_t k_SmallNodes = 16384;
+constexpr std::size_t k_LargeNodes = 240000;
+
+// Every table counts nodes and updates, except where it compares instrumentation policies.
+template <typename t_Link, typename t_Instrumentation = CountingInstrumentation>
+using SmallMatrix = ConstraintMatrix<k_MaxConstraints, k_SmallNodes, t_Link, t_Instrumentation>;
+template <typename t_Link, typename t_Instrumentation = CountingInstrumentation>
+using LargeMatrix = ConstraintMatrix<k_MaxConstraints, k_LargeNodes, t_Link, t_Instrumentation>;
+using SmallBitset = BitsetMatrix<k_MaxConstraints, k_SmallNodes, CountingInstrumentation>;
+using SmallCells = DancingCells<k_MaxConstraints, k_SmallNodes, std::uint32_t, CountingInstrumentation>;
+using LargeCells = DancingCells<k_MaxConstraints, k_LargeNodes, std::uint32_t, CountingInstrumentation>;
+
+// Counts the cache misses of this thread between Start() and Stop(), where the kernel allows it (-1 otherwise).
+class CacheMissCounter {
+public:
+    CacheMissCounter() {
+#ifdef __linux__
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        m_Fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif // __linux__
+    }
+    ~CacheMissCounter() {
+#ifdef __linux__
+        if (m_Fd >= 0) {
+            close(m_Fd);
+        }
+#endif // __linux__
+    }
+
+    void Start() {
+#ifdef __linux__
+        if (m_Fd >= 0) {
+            ioctl(m_Fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(m_Fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif // __linux__
+    }
+    std::int64_t Stop() {
+        std::int64_t count = -1;
+#ifdef __linux__
+        if (m_Fd >= 0) {
+            ioctl(m_Fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(m_Fd, &count, sizeof(count)) != sizeof(count)) {
+                count = -1;
+            }
+        }
+#endif // __linux__
+        return count;
+    }
+
+private:
+    int m_Fd = -1;
+};
+
+struct Result {
+    int solutions = 0;
+    double ms = 0;
+    std::int64_t nodes = 0;
+    std::int64_t updates = 0;
+    std::int64_t cacheMisses = -1;
+};
+
+// Builds the puzzle into a fresh Matrix and times solve(matrix). Only the solve is measured.
+template <typename Matrix, typename Solve>
+Result Run(const Puzzle &puzzle, Solve solve) {
+    auto matrix = std::make_unique<Matrix>(puzzle.constraints, puzzle.optionalConstraints);
+    for (std::size_t r = 0; r < puzzle.rows.size(); ++r) {
+        // Only ConstraintMatrix takes colors.
+        if constexpr (requires { matrix->AddPossibility(puzzle.rows[r], puzzle.rows[r]); }) {
+            matrix->AddPossibility(puzzle.rows[r], puzzle.colors.empty() ? std::vector<int>{} : puzzle.colors[r]);
+        } else {
+            assert(puzzle.colors.empty());
+            matrix->AddPossibility(puzzle.rows[r]);
+        }
+    }
+    // Likewise multiplicities.
+    if constexpr (requires { matrix->SetMultiplicity(0, 1, 1); }) {
+        for (const auto &[constraint, lower, upper] : puzzle.multiplicities) {
+            matrix->SetMultiplicity(constraint, lower, upper);
+        }
+    } else {
+        assert(puzzle.multiplicities.empty());
+    }
+
+    Result result;
+    CacheMissCounter cacheMisses;
+    const auto time_s = std::chrono::high_resolution_clock::now();
+    cacheMisses.Start();
+    result.solutions = solve(*matrix);
+    result.cacheMisses = cacheMisses.Stop();
+    const auto time_e = std::chrono::high_resolution_clock::now();
+    result.ms = std::chrono::duration<double, std::milli>(time_e - time_s).count();
+    result.nodes = matrix->Instrumentation().TotalNodes();
+    result.updates = matrix->Instrumentation().TotalUpdates();
+    return result;
+}
+
+template <typename Matrix>
+Result Run(const Puzzle &puzzle) {
+    return Run<Matrix>(puzzle, [](Matrix &matrix) { return matrix.Solutions(); });
+}
+
+void PrintHeader(const std::string &title) {
+    std::cout << "\n== " << title << " ==\n";
+    std::cout << "Puzzle\tConfiguration\tSolutions\tms\tNodes\tUpdates\tUpdates/us\tCache misses\n";
+}
+
+void PrintRow(const Puzzle &puzzle, const std::string &config, const Result &result) {
+    std::cout << puzzle.name << '\t' << config << '\t' << result.solutions << '\t' << result.ms << '\t' << result.nodes
+              << '\t' << result.updates << '\t' << result.updates / (result.ms * 1000) << '\t';
+    if (result.cacheMisses >= 0) {
+        std::cout << result.cacheMisses;
+    } else {
+        std::cout << '-';
+    }
+    std::cout << '\n';
+}
+
+// Sudoku.cpp's board with most of its bottom three rows cleared, so that there are many completions to count.
+Puzzle BenchmarkSudoku() {
+    return SudokuPuzzle({
+        "53..7....",
+        "6..195...",
+        ".98....6.",
+        "8...6...3",
+        "4..8.3..1",
+        "7...2...6",
+        ".........",
+        "...4.....",
+        ".........",
+    });
+}
+
+// Node size against link width. 8-byte links give the 40-byte nodes of a pointer-linked matrix.
+void LinkWidthTable() {
+    PrintHeader("Link width");
+    for (const Puzzle &puzzle : {BenchmarkSudoku(), NQueensPuzzle(12), PentominoPuzzle()}) {
+        PrintRow(puzzle, "uint16 (10B nodes)", Run<SmallMatrix<std::uint16_t>>(puzzle));
+        PrintRow(puzzle, "uint32 (20B nodes)", Run<SmallMatrix<std::uint32_t>>(puzzle));
+        PrintRow(puzzle, "uint64 (40B nodes)", Run<SmallMatrix<std::uint64_t>>(puzzle));
+    }
+    const Puzzle words = WordSquarePuzzle();
+    PrintRow(words, "uint32 (20B nodes)", Run<LargeMatrix<std::uint32_t>>(words));
+    PrintRow(words, "uint64 (40B nodes)", Run<LargeMatrix<std::uint64_t>>(words));
+}
+
+// Rescanning every header at each search node against the bucket queue maintained by cover and uncover, on the
+// widest puzzles. Setting the policy (building the buckets) is timed with the solve.
+void ColumnSelectionTable() {
+    PrintHeader("Column selection");
+    const auto scan = [](auto &matrix) {
+        matrix.SetColumnSelection(std::decay_t<decltype(matrix)>::ColumnSelection::Scan);
+        return matrix.Solutions();
+    };
+    const auto buckets = [](auto &matrix) {
+        matrix.SetColumnSelection(std::decay_t<decltype(matrix)>::ColumnSelection::BucketQueue);
+        return matrix.Solutions();
+    };
+    for (const Puzzle &puzzle : {BenchmarkSudoku(), NQueensPuzzle(12)}) {
+        PrintRow(puzzle, "Scan", Run<SmallMatrix<std::uint32_t>>(puzzle, scan));
+        PrintRow(puzzle, "Bucket queue", Run<SmallMatrix<std::uint32_t>>(puzzle, buckets));
+    }
+    const Puzzle words = WordSquarePuzzle();
+    PrintRow(words, "Scan", Run<LargeMatrix<std::uint32_t>>(words, scan));
+    PrintRow(words, "Bucket queue", Run<LargeMatrix<std::uint32_t>>(words, buckets));
+}
+
+// Dancing links against the bit-parallel backend that ExactCover picks for up to 256 constraints. Both search the
+// same tree; Sudoku is wider than the cutoff and is run on BitsetMatrix explicitly.
+void BitsetTable() {
+    PrintHeader("Bitset backend");
+    for (const Puzzle &puzzle : {BenchmarkSudoku(), NQueensPuzzle(12), PentominoPuzzle()}) {
+        PrintRow(puzzle, "ConstraintMatrix", Run<SmallMatrix<std::uint32_t>>(puzzle));
+        PrintRow(puzzle, "BitsetMatrix", Run<SmallBitset>(puzzle));
+    }
+}
+
+// Dancing links against dancing cells. Swapping reorders the possibilities of each constraint, so the two engines
+// break ties differently and the node counts differ slightly.
+void DancingCellsTable() {
+    PrintHeader("Dancing cells");
+    for (const Puzzle &puzzle : {BenchmarkSudoku(), NQueensPuzzle(12), PentominoPuzzle()}) {
+        PrintRow(puzzle, "Dancing links", Run<SmallMatrix<std::uint32_t>>(puzzle));
+        PrintRow(puzzle, "Dancing cells", Run<SmallCells>(puzzle));
+    }
+    const Puzzle words = WordSquarePuzzle();
+    PrintRow(words, "Dancing links", Run<LargeMatrix<std::uint32_t>>(words));
+    PrintRow(words, "Dancing cells", Run<LargeCells>(words));
+}
+
+// WordSquare with every letter a cell does not hold as its own column, against one colored optional column per cell.
+void ColorsTable() {
+    PrintHeader("Colored constraints");
+    const Puzzle words = WordSquarePuzzle();
+    const Puzzle colored = WordSquareColoredPuzzle();
+    PrintRow(words, std::to_string(words.Nodes()) + " nodes", Run<LargeMatrix<std::uint32_t>>(words));
+    PrintRow(colored, std::to_string(colored.Nodes()) + " nodes", Run<SmallMatrix<std::uint32_t>>(colored));
+}
+
+// Two copies of each piece, as one column per copy (every solution found once per permutation of the copies) against
+// one column per piece that takes exactly two possibilities.
+void MultiplicityTable() {
+    PrintHeader("Multiplicities");
+    for (const Puzzle &puzzle : {TetrominoPairsPuzzle(false), TetrominoPairsPuzzle(true)}) {
+        PrintRow(puzzle, std::to_string(puzzle.rows.size()) + " rows", Run<SmallMatrix<std::uint32_t>>(puzzle));
+    }
+}
+
+// The cost of the instrumentation policies themselves. NullInstrumentation reports no nodes or updates.
+void InstrumentationTable() {
+    PrintHeader("Instrumentation");
+    for (const Puzzle &puzzle : {BenchmarkSudoku(), NQueensPuzzle(12), PentominoPuzzle()}) {
+        PrintRow(puzzle, "Null", Run<SmallMatrix<std::uint32_t, NullInstrumentation>>(puzzle));
+        PrintRow(puzzle, "Counting", Run<SmallMatrix<std::uint32_t, CountingInstrumentation>>(puzzle));
+        PrintRow(puzzle, "Detailed", Run<SmallMatrix<std::uint32_t, DetailedInstrumentation>>(puzzle));
+    }
+}
+
+// Enumerating every solution against building the ZDD of all of them (Knuth's DXZ), which finds each subproblem's
+// solutions once. Counting them afterwards is linear in the size of the ZDD.
+void ZddTable() {
+    PrintHeader("ZDD");
+    using Matrix = SmallMatrix<std::uint32_t>;
+    for (const Puzzle &puzzle :
+         {BenchmarkSudoku(), NQueensPuzzle(12), PentominoPuzzle(), TetrominoPairsPuzzle(false)}) {
+        PrintRow(puzzle, "Solutions", Run<Matrix>(puzzle));
+        std::size_t nodes = 0, bytes = 0;
+        const Result result = Run<Matrix>(puzzle, [&](Matrix &matrix) {
+            const Zdd zdd = matrix.SolutionsZdd();
+            nodes = zdd.Nodes();
+            bytes = zdd.Bytes();
+            return static_cast<int>(zdd.Count());
+        });
+        PrintRow(puzzle, "ZDD (" + std::to_string(nodes) + " nodes, " + std::to_string(bytes / 1024) + " KiB)", result);
+    }
+}
+
+// Enumerating every solution against counting them with transposition tables of two sizes. The configuration column
+// shows the table's hit rate.
+void CountingTable() {
+    PrintHeader("Transposition table");
+    using Matrix = SmallMatrix<std::uint32_t>;
+    for (const Puzzle &puzzle : {NQueensPuzzle(12), PentominoPuzzle(), TetrominoPairsPuzzle(false)}) {
+        PrintRow(puzzle, "Solutions", Run<Matrix>(puzzle));
+        for (const std::size_t megabytes : {1, 64}) {
+            double hitRate = 0;
+            const Result result = Run<Matrix>(puzzle, [&](Matrix &matrix) {
+                const auto solutions = static_cast<int>(matrix.CountSolutions(megabytes << 20));
+                const auto &stats = matrix.TableStats();
+                hitRate = double(stats.hits) / double(stats.hits + stats.misses);
+                return solutions;
+            });
+            PrintRow(puzzle,
+                     std::to_string(megabytes) + " MiB table (" + std::to_string(int(hitRate * 100)) + "% hits)",
+                     result);
+        }
+    }
+}
+
+// Plain search against looking for independent parts down to a few levels, on two puzzles side by side and on boards
+// that selections can wall off. The configuration column shows how often the matrix was split.
+void ComponentsTable() {
+    PrintHeader("Component decomposition");
+    using Matrix = SmallMatrix<std::uint32_t>;
+    for (const Puzzle &puzzle : {DisjointPuzzles(NQueensPuzzle(8), NQueensPuzzle(8)), PentominoPuzzle(),
+                                 TetrominoPairsPuzzle(false)}) {
+        PrintRow(puzzle, "Solutions", Run<Matrix>(puzzle));
+        for (const int maxDepth : {0, 4}) {
+            std::uint64_t decompositions = 0;
+            const Result result = Run<Matrix>(puzzle, [&](Matrix &matrix) {
+                matrix.SetDecompositionDepth(maxDepth);
+                const int solutions = matrix.Solutions();
+                decompositions = matrix.Decompositions();
+                return solutions;
+            });
+            PrintRow(puzzle,
+                     "Depth " + std::to_string(maxDepth) + " (" + std::to_string(decompositions) + " splits)",
+                     result);
+        }
+    }
+}
+
+// Sequential search against SolutionsParallel() with 1, 2 and 4 workers and one per hardware thread. The extra nodes
+// of the parallel rows are the prefixes that workers replay after stealing work.
+void ParallelTable() {
+    PrintHeader("Parallel search");
+    using Matrix = SmallMatrix<std::uint32_t>;
+    std::vector<unsigned> threadCounts = {1, 2, 4, std::max(1u, std::thread::hardware_concurrency())};
+    std::sort(threadCounts.begin(), threadCounts.end());
+    threadCounts.erase(std::unique(threadCounts.begin(), threadCounts.end()), threadCounts.end());
+    for (const Puzzle &puzzle : {NQueensPuzzle(12), PentominoPuzzle(), BenchmarkSudoku()}) {
+        PrintRow(puzzle, "Solutions", Run<Matrix>(puzzle));
+        for (const unsigned threads : threadCounts) {
+            PrintRow(puzzle, std::to_string(threads) + (threads == 1 ? " thread" : " threads"),
+                     Run<Matrix>(puzzle, [&](Matrix &matrix) { return matrix.SolutionsParallel(threads); }));
+        }
+    }
+}
+
+// Placing every rotation and reflection of the pentominoes repeats the possibilities of the symmetric ones. Merging
+// the duplicates searches the same tree as the distinct orientations and multiplies the count back up. The unmerged
+// search takes minutes, so this table only runs when named on the command line.
+void DuplicatesTable() {
+    PrintHeader("Duplicate possibilities");
+    using Matrix = SmallMatrix<std::uint32_t>;
+    const Puzzle puzzle = PentominoPuzzle(true);
+    PrintRow(puzzle, std::to_string(puzzle.rows.size()) + " rows", Run<Matrix>(puzzle));
+    std::size_t merged = 0;
+    const Result result = Run<Matrix>(puzzle, [&](Matrix &matrix) {
+        merged = matrix.MergeDuplicatePossibilities();
+        return matrix.Solutions();
+    });
+    PrintRow(puzzle, std::to_string(puzzle.rows.size() - merged) + " rows (merged)", result);
+}
+
+// Searching the matrix as built against reducing it first (selecting forced possibilities, dropping those that would
+// leave a constraint empty, and compacting the rest). The reduction is timed with the solve. The configuration column
+// shows how many possibilities and constraints it eliminated.
+void ReductionTable() {
+    PrintHeader("Root reduction");
+    using Matrix = SmallMatrix<std::uint32_t>;
+    // Sudoku.cpp's board.
+    const Puzzle classic = SudokuPuzzle({
+        "53..7....",
+        "6..195...",
+        ".98....6.",
+        "8...6...3",
+        "4..8.3..1",
+        "7...2...6",
+        ".6....28.",
+        "...419..5",
+        "....8..79",
+    });
+    for (const Puzzle &puzzle : {classic, BenchmarkSudoku(), PentominoPuzzle()}) {
+        PrintRow(puzzle, std::to_string(puzzle.rows.size()) + " rows", Run<Matrix>(puzzle));
+        Matrix::Reduction reduction;
+        const Result result = Run<Matrix>(puzzle, [&](Matrix &matrix) {
+            reduction = matrix.Reduce();
+            return reduction.infeasible ? 0 : matrix.Solutions();
+        });
+        PrintRow(puzzle,
+                 "Reduced (-" + std::to_string(reduction.forcedRows + reduction.deadRows) + " rows, -" +
+                     std::to_string(reduction.coveredColumns + reduction.unusedColumns) + " constraints)",
+                 result);
+    }
+}
+
+// Branching on every column against propagating after each selection. Forced selections are not search nodes; the
+// configuration column shows how many there were and how many branches failed before choosing a column.
+void PropagationTable() {
+    PrintHeader("Propagation");
+    using Matrix = SmallMatrix<std::uint32_t>;
+    for (const Puzzle &puzzle : {BenchmarkSudoku(), NQueensPuzzle(12), PentominoPuzzle()}) {
+        PrintRow(puzzle, "Off", Run<Matrix>(puzzle));
+        std::int64_t forced = 0, conflicts = 0;
+        const Result result = Run<Matrix>(puzzle, [&](Matrix &matrix) {
+            matrix.SetPropagation(true);
+            const int solutions = matrix.Solutions();
+            forced = matrix.Instrumentation().TotalForced();
+            conflicts = matrix.Instrumentation().TotalConflicts();
+            return solutions;
+        });
+        PrintRow(puzzle, "On (" + std::to_string(forced) + " forced, " + std::to_string(conflicts) + " conflicts)",
+                 result);
+    }
+}
+
+// Plain search against learning nogoods from failed subtrees, with a small and a large store. The configuration column
+// shows how many nogoods were learned and how many branches they pruned.
+void NogoodTable() {
+    PrintHeader("Nogood learning");
+    const auto run = [](const Puzzle &puzzle, auto tag) {
+        using Matrix = typename decltype(tag)::type;
+        PrintRow(puzzle, "Off", Run<Matrix>(puzzle));
+        for (const std::size_t capacity : {1024, 1 << 16}) {
+            typename Matrix::NogoodStats stats;
+            const Result result = Run<Matrix>(puzzle, [&](Matrix &matrix) {
+                matrix.SetNogoodLearning(capacity);
+                const int solutions = matrix.Solutions();
+                stats = matrix.LearningStats();
+                return solutions;
+            });
+            PrintRow(puzzle,
+                     std::to_string(capacity) + " nogoods (" + std::to_string(stats.learned) + " learned, " +
+                         std::to_string(stats.pruned) + " pruned)",
+                     result);
+        }
+    };
+    run(PentominoPuzzle(), std::type_identity<SmallMatrix<std::uint32_t>>{});
+    run(WordSquarePuzzle(), std::type_identity<LargeMatrix<std::uint32_t>>{});
+}
+
+// Plain search against detecting the symmetries of the matrix and searching one branch per orbit. Detection is timed
+// with the solve. The configuration column shows the order of the group found.
+void SymmetryTable() {
+    PrintHeader("Symmetry breaking");
+    using Matrix = SmallMatrix<std::uint32_t>;
+    for (const Puzzle &puzzle : {NQueensPuzzle(12), PentominoPuzzle(), TetrominoPairsPuzzle(false)}) {
+        PrintRow(puzzle, "Off", Run<Matrix>(puzzle));
+        std::size_t order = 0;
+        const Result result = Run<Matrix>(puzzle, [&](Matrix &matrix) {
+            order = matrix.DetectSymmetries();
+            return matrix.Solutions();
+        });
+        PrintRow(puzzle, "Group of " + std::to_string(order), result);
+    }
+}
+
+// Keeping one solution of every class under the puzzle's symmetries: deduplicating every solution found, by its
+// smallest image, against having the search report only the canonical solution of each class. Both count the
+// classes.
+void CanonicalTable() {
+    PrintHeader("Canonical solutions");
+    using Matrix = SmallMatrix<std::uint32_t>;
+    using Solution = std::vector<std::vector<std::size_t>>;
+    for (const Puzzle &puzzle : {NQueensPuzzle(10), PentominoPuzzle()}) {
+        const Result found = Run<Matrix>(puzzle, [&](Matrix &matrix) {
+            std::set<Solution> classes;
+            matrix.SetPrintFunction([&](Solution selections) {
+                Solution smallest;
+                for (const std::vector<std::size_t> &permutation : puzzle.symmetries) {
+                    Solution image = selections;
+                    for (std::vector<std::size_t> &row : image) {
+                        for (std::size_t &constraint : row) {
+                            constraint = permutation[constraint];
+                        }
+                        std::sort(row.begin(), row.end());
+                    }
+                    std::sort(image.begin(), image.end());
+                    if (smallest.empty() || image < smallest) {
+                        smallest = std::move(image);
+                    }
+                }
+                classes.insert(std::move(smallest));
+            });
+            matrix.Solutions();
+            return static_cast<int>(classes.size());
+        });
+        PrintRow(puzzle, "Deduplicated after", found);
+        PrintRow(puzzle, "Canonical only", Run<Matrix>(puzzle, [&](Matrix &matrix) {
+                     matrix.SetSolutionSymmetries(puzzle.symmetries);
+                     return matrix.Solutions();
+                 }));
+    }
+}
+
+// Time to the first solution: the deterministic search against random tie-breaking and row order, without and with
+// Luby restarts. Random configurations run once per seed and show the median and worst of the runs, nodes included.
+void FirstSolutionTable() {
+    PrintHeader("First solution");
+    constexpr std::uint64_t seeds = 32;
+    const auto run = [](const Puzzle &puzzle, auto tag) {
+        using Matrix = typename decltype(tag)::type;
+        PrintRow(puzzle, "Deterministic", Run<Matrix>(puzzle, [](Matrix &matrix) {
+                     matrix.SetFirstSolution(true);
+                     return matrix.Solutions();
+                 }));
+        for (const std::uint64_t restartNodes : {0, 64, 1024}) {
+            std::vector<Result> results;
+            for (std::uint64_t seed = 1; seed <= seeds; ++seed) {
+                results.push_back(Run<Matrix>(puzzle, [&](Matrix &matrix) {
+                    matrix.SetRandomization(seed);
+                    matrix.SetFirstSolution(true, restartNodes);
+                    return matrix.Solutions();
+                }));
+            }
+            std::sort(results.begin(), results.end(), [](const Result &a, const Result &b) { return a.ms < b.ms; });
+            const std::string config =
+                restartNodes == 0 ? "Random" : "Random, restarts of " + std::to_string(restartNodes) + " x Luby";
+            PrintRow(puzzle, config + " (median)", results[seeds / 2]);
+            PrintRow(puzzle, config + " (worst)", results.back());
+        }
+    };
+    run(NQueensPuzzle(60), std::type_identity<SmallMatrix<std::uint32_t>>{});
+    run(PentominoPuzzle(), std::type_identity<SmallMatrix<std::uint32_t>>{});
+    run(TetrominoPairsPuzzle(false), std::type_identity<SmallMatrix<std::uint32_t>>{});
+    run(WordSquarePuzzle(), std::type_identity<LargeMatrix<std::uint32_t>>{});
+}
+
+// Knuth's estimate of the search against the search itself. Each estimate row shows the estimated solutions, nodes
+// and updates and the time taken by the probes, with the 95% interval of the nodes in the configuration column.
+void EstimateTable() {
+    PrintHeader("Tree size estimates");
+    const auto run = [](const Puzzle &puzzle, auto tag) {
+        using Matrix = typename decltype(tag)::type;
+        PrintRow(puzzle, "Search", Run<Matrix>(puzzle));
+        for (const std::size_t samples : {100, 1000}) {
+            typename Matrix::TreeEstimate estimate;
+            Result result = Run<Matrix>(puzzle, [&](Matrix &matrix) {
+                estimate = matrix.Estimate(samples);
+                return 0;
+            });
+            result.solutions = static_cast<int>(std::lround(estimate.solutions.mean));
+            result.nodes = std::llround(estimate.nodes.mean);
+            result.updates = std::llround(estimate.updates.mean);
+            PrintRow(puzzle,
+                     std::to_string(samples) + " samples (nodes " + std::to_string(std::llround(estimate.nodes.low)) +
+                         "-" + std::to_string(std::llround(estimate.nodes.high)) + ")",
+                     result);
+        }
+    };
+    run(NQueensPuzzle(12), std::type_identity<SmallMatrix<std::uint32_t>>{});
+    run(PentominoPuzzle(), std::type_identity<SmallMatrix<std::uint32_t>>{});
+    run(WordSquarePuzzle(), std::type_identity<LargeMatrix<std::uint32_t>>{});
+}
+
+// Required constraints of NQueensPuzzle(n) in NQueens.cpp's organ-pipe order: rows and columns alternate from the
+// middle of the board outwards.
+std::vector<int> OrganPipePriorities(int n) {
+    std::vector<int> priorities(n * 2);
+    for (int i = 0; i < n; ++i) {
+        const int fromMiddle = i >= n / 2 ? (i - n / 2) * 2 : (n / 2 - i) * 2 - 1;
+        priorities[i] = fromMiddle * 2;
+        priorities[n + i] = fromMiddle * 2 + 1;
+    }
+    return priorities;
+}
+
+// Every branching policy on each puzzle. The static orders (first column, and a priority where the puzzle has a
+// natural one, NQueens.cpp's organ-pipe order) only run where they finish in seconds.
+void BranchingTable() {
+    PrintHeader("Branching policies");
+    using Matrix = SmallMatrix<std::uint32_t>;
+    const auto run = [](const Puzzle &puzzle, bool staticOrders, const std::vector<int> &priorities, auto tag) {
+        using Matrix = typename decltype(tag)::type;
+        using Branching = typename Matrix::Branching;
+        const auto branching = [](Branching policy, const std::vector<int> &priorities = {}) {
+            return [=](Matrix &matrix) {
+                matrix.SetBranching(policy, priorities);
+                return matrix.Solutions();
+            };
+        };
+        PrintRow(puzzle, "Fewest (MRV)", Run<Matrix>(puzzle, branching(Branching::Fewest)));
+        if (staticOrders) {
+            PrintRow(puzzle, "First", Run<Matrix>(puzzle, branching(Branching::First)));
+        }
+        if (!priorities.empty()) {
+            PrintRow(puzzle, "Priority", Run<Matrix>(puzzle, branching(Branching::Priority, priorities)));
+            PrintRow(puzzle, "Fewest, then priority",
+                     Run<Matrix>(puzzle, branching(Branching::FewestThenPriority, priorities)));
+        }
+        PrintRow(puzzle, "Fewest, then row length", Run<Matrix>(puzzle, branching(Branching::FewestThenLength)));
+    };
+    run(NQueensPuzzle(12), true, OrganPipePriorities(12), std::type_identity<Matrix>{});
+    run(PentominoPuzzle(), false, {}, std::type_identity<Matrix>{});
+    run(BenchmarkSudoku(), false, {}, std::type_identity<Matrix>{});
+    run(WordSquarePuzzle(), false, {}, std::type_identity<LargeMatrix<std::uint32_t>>{});
+}
+
+// MRV against failure-weighted selection (dom/wdeg), from fresh weights and then seeded with the weights the first
+// weighted run ended with.
+void FailureWeightTable() {
+    PrintHeader("Failure-weighted branching");
+    const auto run = [](const Puzzle &puzzle, auto tag) {
+        using Matrix = typename decltype(tag)::type;
+        using Branching = typename Matrix::Branching;
+        PrintRow(puzzle, "Fewest (MRV)", Run<Matrix>(puzzle));
+        std::vector<std::uint32_t> profile;
+        PrintRow(puzzle, "Failure-weighted", Run<Matrix>(puzzle, [&](Matrix &matrix) {
+                     matrix.SetBranching(Branching::FailureWeighted);
+                     const int solutions = matrix.Solutions();
+                     profile = matrix.FailureWeights();
+                     return solutions;
+                 }));
+        PrintRow(puzzle, "Failure-weighted, seeded", Run<Matrix>(puzzle, [&](Matrix &matrix) {
+                     matrix.SetBranching(Branching::FailureWeighted);
+                     matrix.SetFailureWeights(profile);
+                     return matrix.Solutions();
+                 }));
+    };
+    run(NQueensPuzzle(12), std::type_identity<SmallMatrix<std::uint32_t>>{});
+    run(PentominoPuzzle(), std::type_identity<SmallMatrix<std::uint32_t>>{});
+    run(TetrominoPairsPuzzle(false), std::type_identity<SmallMatrix<std::uint32_t>>{});
+    run(BenchmarkSudoku(), std::type_identity<SmallMatrix<std::uint32_t>>{});
+    run(WordSquarePuzzle(), std::type_identity<LargeMatrix<std::uint32_t>>{});
+}
+
+// Time to the first solution under each order of the possibilities within the column branched on. Ordering is
+// timed with the solve.
+void RowOrderingTable() {
+    PrintHeader("Row ordering (first solution)");
+    const auto run = [](const Puzzle &puzzle, auto tag) {
+        using Matrix = typename decltype(tag)::type;
+        using RowOrdering = typename Matrix::RowOrdering;
+        const auto first = [](RowOrdering ordering) {
+            return [=](Matrix &matrix) {
+                matrix.SetRowOrdering(ordering);
+                matrix.SetFirstSolution(true);
+                return matrix.Solutions();
+            };
+        };
+        PrintRow(puzzle, "Insertion", Run<Matrix>(puzzle, first(RowOrdering::Insertion)));
+        PrintRow(puzzle, "Least constraining", Run<Matrix>(puzzle, first(RowOrdering::LeastConstraining)));
+        PrintRow(puzzle, "Most covering", Run<Matrix>(puzzle, first(RowOrdering::MostCovering)));
+    };
+    run(NQueensPuzzle(60), std::type_identity<SmallMatrix<std::uint32_t>>{});
+    run(PentominoPuzzle(), std::type_identity<SmallMatrix<std::uint32_t>>{});
+    run(TetrominoPairsPuzzle(false), std::type_identity<SmallMatrix<std::uint32_t>>{});
+    run(BenchmarkSudoku(), std::type_identity<SmallMatrix<std::uint32_t>>{});
+    run(WordSquarePuzzle(), std::type_identity<LargeMatrix<std::uint32_t>>{});
+}
+
+// Building the matrix one AddPossibility() at a time, from the puzzle's rows, against one AddPossibilities() call on
+// the same rows in compressed sparse row form (flattened beforehand, as a caller would generate them). Only the build
+// is timed, best of five.
+void SetupTable() {
+    std::cout << "\n== Matrix setup ==\n";
+    std::cout << "Puzzle\tBuilder\tRows\tNodes\tms\n";
+    const auto run = [](const Puzzle &puzzle, auto tag) {
+        using Matrix = typename decltype(tag)::type;
+        std::vector<std::size_t> offsets{0};
+        std::vector<int> constraints, colors;
+        for (std::size_t r = 0; r < puzzle.rows.size(); ++r) {
+            constraints.insert(constraints.end(), puzzle.rows[r].begin(), puzzle.rows[r].end());
+            if (!puzzle.colors.empty()) {
+                colors.insert(colors.end(), puzzle.colors[r].begin(), puzzle.colors[r].end());
+            }
+            offsets.push_back(constraints.size());
+        }
+        const auto time = [&](auto build) {
+            double best = std::numeric_limits<double>::max();
+            for (int i = 0; i < 5; ++i) {
+                auto matrix = std::make_unique<Matrix>(puzzle.constraints, puzzle.optionalConstraints);
+                const auto time_s = std::chrono::high_resolution_clock::now();
+                build(*matrix);
+                const auto time_e = std::chrono::high_resolution_clock::now();
+                best = std::min(best, std::chrono::duration<double, std::milli>(time_e - time_s).count());
+            }
+            return best;
+        };
+        const double perRow = time([&](Matrix &matrix) {
+            for (std::size_t r = 0; r < puzzle.rows.size(); ++r) {
+                matrix.AddPossibility(puzzle.rows[r], puzzle.colors.empty() ? std::vector<int>{} : puzzle.colors[r]);
+            }
+        });
+        const double bulk = time([&](Matrix &matrix) { matrix.AddPossibilities(offsets, constraints, colors); });
+        for (const auto &[builder, ms] : {std::pair{"AddPossibility", perRow}, std::pair{"AddPossibilities", bulk}}) {
+            std::cout << puzzle.name << '\t' << builder << '\t' << puzzle.rows.size() << '\t' << puzzle.Nodes() << '\t'
+                      << ms << '\n';
+        }
+    };
+    run(PentominoPuzzle(), std::type_identity<SmallMatrix<std::uint32_t>>{});
+    run(BenchmarkSudoku(), std::type_identity<SmallMatrix<std::uint32_t>>{});
+    run(WordSquarePuzzle(), std::type_identity<LargeMatrix<std::uint32_t>>{});
+    run(WordSquareColoredPuzzle(), std::type_identity<LargeMatrix<std::uint32_t>>{});
+}
+
+} // namespace
+
+// Runs every table but the slow ones, or only those named on the command line.
+int main(int argc, char **argv) {
+    const std::vector<std::pair<std::string, void (*)()>> tables = {
+        {"links", LinkWidthTable},
+        {"selection", ColumnSelectionTable},
+        {"bitset", BitsetTable},
+        {"cells", DancingCellsTable},
+        {"colors", ColorsTable},
+        {"multiplicity", MultiplicityTable},
+        {"instrumentation", InstrumentationTable},
+        {"zdd", ZddTable},
+        {"transposition", CountingTable},
+        {"components", ComponentsTable},
+        {"parallel", ParallelTable},
+        {"duplicates", DuplicatesTable},
+        {"reduction", ReductionTable},
+        {"propagation", PropagationTable},
+        {"nogoods", NogoodTable},
+        {"symmetry", SymmetryTable},
+        {"canonical", CanonicalTable},
+        {"first", FirstSolutionTable},
+        {"estimate", EstimateTable},
+        {"branching", BranchingTable},
+        {"failures", FailureWeightTable},
+        {"rows", RowOrderingTable},
+        {"setup", SetupTable},
+    };
+    const std::vector<std::string> slowTables = {"duplicates"};
+
+    for (const auto &[name, table] : tables) {
+        bool selected = argc < 2 && std::find(slowTables.begin(), slowTables.end(), name) == slowTables.end();
+        for (int i = 1; i < argc; ++i) {
+            selected |= name == argv[i];
+        }
+        if (selected) {
+            table();
+        }
+    }
+
+    return 0;
+}
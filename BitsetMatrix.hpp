@@ -0,0 +1,371 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "ConstraintMatrix.hpp"
+
+// Exact cover solver for matrices with few constraints, with the same interface as ConstraintMatrix. Nothing dances:
+// every possibility (row) knows which rows it conflicts with as a bitset over rows, and each search level holds the
+// set of rows still live and the set of constraints still uncovered. Selecting a row is one AND-NOT over the live rows,
+// and a constraint's count is a popcount of its rows AND the live rows.
+//
+// Columns are chosen and rows are tried in the same order as ConstraintMatrix, so the search visits the same nodes and
+// reports the same solutions in the same order. Updates are not counted, there are none.
+template <std::size_t t_MaxConstraints, std::size_t t_MaxRows, typename t_Instrumentation = NullInstrumentation>
+class BitsetMatrix {
+private:
+    using PrintFunctionType = std::function<void(std::vector<std::vector<std::size_t>>)>;
+    using Word = std::uint64_t;
+
+    static constexpr std::size_t k_WordBits = 64;
+    static constexpr std::size_t k_ColWords = (t_MaxConstraints + k_WordBits - 1) / k_WordBits;
+    static constexpr int k_DefaultSplitDepth = 2;
+
+    using ColumnSet = std::array<Word, k_ColWords>;
+
+public:
+    BitsetMatrix(std::size_t constraints, std::size_t optionalConstraints = 0)
+    : m_NumReqConstraints(constraints)
+    , m_NumOptConstraints(optionalConstraints)
+    , m_NumTotalConstraints(constraints + optionalConstraints) {
+        assert(m_NumTotalConstraints <= t_MaxConstraints);
+        for (std::size_t c = 0; c < m_NumTotalConstraints; ++c) {
+            SetBit(m_AllColumns, c);
+            if (c < m_NumReqConstraints) {
+                SetBit(m_ReqColumns, c);
+            }
+        }
+    }
+
+    void SetPrintFunction(PrintFunctionType printFunc) { m_PrintFunction = printFunc; }
+
+    int Solutions(int depth = 0) {
+        if (depth == 0) {
+            m_Instrumentation.Reset();
+        }
+        Prepare();
+        Stack stack(*this);
+        const int solutions = Search(stack, 0, depth);
+        m_Instrumentation.Merge(stack.instrumentation);
+        return solutions;
+    }
+
+    // Counts (and reports) the same solutions as Solutions() using numThreads workers (0 = one per hardware thread).
+    // The tree is expanded down to splitDepth levels first; the workers then take these subtrees from a shared queue.
+    // The print function may be called from any worker, but never concurrently.
+    int SolutionsParallel(unsigned numThreads = 0, int splitDepth = k_DefaultSplitDepth) {
+        if (numThreads == 0) {
+            numThreads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        m_Instrumentation.Reset();
+        Prepare();
+
+        // Solutions shallower than splitDepth are found while expanding.
+        std::vector<Task> tasks;
+        Stack stack(*this);
+        int solutions = Expand(stack, 0, std::max(splitDepth, 1), tasks);
+        m_Instrumentation.Merge(stack.instrumentation);
+
+        std::mutex printMutex;
+        PrintFunctionType print;
+        if (m_PrintFunction) {
+            print = [this, &printMutex](std::vector<std::vector<std::size_t>> selections) {
+                std::lock_guard lock(printMutex);
+                m_PrintFunction(std::move(selections));
+            };
+        }
+
+        std::atomic<std::size_t> nextTask{0};
+        std::atomic<int> found{0};
+        std::vector<t_Instrumentation> instrumentation(numThreads);
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < numThreads; ++i) {
+            threads.emplace_back([&, i] {
+                Stack stack(*this);
+                stack.print = print;
+                int workerSolutions = 0;
+                for (std::size_t t = nextTask++; t < tasks.size(); t = nextTask++) {
+                    const int depth = static_cast<int>(tasks[t].size());
+                    for (int level = 0; level < depth; ++level) {
+                        stack.col[level] = tasks[t][level].col;
+                        Select(stack, level, tasks[t][level].row);
+                    }
+                    workerSolutions += Search(stack, depth, depth);
+                }
+                found += workerSolutions;
+                instrumentation[i] = stack.instrumentation;
+            });
+        }
+        for (unsigned i = 0; i < numThreads; ++i) {
+            threads[i].join();
+            m_Instrumentation.Merge(instrumentation[i]);
+        }
+        return solutions + found;
+    }
+
+    void AddPossibility(const std::vector<int> &constraints) {
+        assert(m_RowCols.size() < t_MaxRows);
+        ColumnSet mask{};
+        for (int cix : constraints) {
+            assert(cix < m_NumTotalConstraints);
+            // Check for duplicates
+            assert(!TestBit(mask, cix));
+            SetBit(mask, cix);
+        }
+        m_RowCols.push_back(constraints);
+        m_RowMasks.push_back(mask);
+        m_Prepared = false;
+    }
+
+    const t_Instrumentation &Instrumentation() const { return m_Instrumentation; }
+
+    // The constraint no longer has to be satisfied. Its possibilities still exclude each other, as for an optional one.
+    void RemoveConstraint(int cix) { m_ReqColumns[cix / k_WordBits] &= ~(Word{1} << (cix % k_WordBits)); }
+
+private:
+    // Search state: for every level, the live rows, the uncovered constraints, the constraint being satisfied and the
+    // row currently selected for it. The search itself is const, so every stack counts for itself.
+    struct Stack {
+        explicit Stack(const BitsetMatrix &matrix)
+        : live((matrix.m_NumReqConstraints + 1) * matrix.m_RowWords)
+        , uncovered(matrix.m_NumReqConstraints + 1)
+        , col(matrix.m_NumReqConstraints + 1)
+        , row(matrix.m_NumReqConstraints + 1)
+        , print(matrix.m_PrintFunction) {
+            for (std::size_t r = 0; r < matrix.m_RowCols.size(); ++r) {
+                SetBit(live.data(), r);
+            }
+            uncovered[0] = matrix.m_AllColumns;
+        }
+
+        std::vector<Word> live;
+        std::vector<ColumnSet> uncovered;
+        std::vector<int> col;
+        std::vector<int> row;
+        PrintFunctionType print;
+        [[no_unique_address]] t_Instrumentation instrumentation;
+    };
+
+    // The constraints and rows selected on the way to a subtree searched by SolutionsParallel().
+    struct Selection {
+        int col;
+        int row;
+    };
+    using Task = std::vector<Selection>;
+
+    // Build the bitsets over rows once all possibilities are known.
+    void Prepare() {
+        if (m_Prepared) {
+            return;
+        }
+        const std::size_t numRows = m_RowCols.size();
+        m_RowWords = std::max<std::size_t>(1, (numRows + k_WordBits - 1) / k_WordBits);
+
+        m_ColRows.assign(m_NumTotalConstraints * m_RowWords, 0);
+        for (std::size_t r = 0; r < numRows; ++r) {
+            for (int cix : m_RowCols[r]) {
+                SetBit(&m_ColRows[cix * m_RowWords], r);
+            }
+        }
+
+        // A row conflicts with every row that shares a constraint with it, itself included.
+        m_Conflicts.assign(numRows * m_RowWords, 0);
+        for (std::size_t r = 0; r < numRows; ++r) {
+            Word *conflicts = &m_Conflicts[r * m_RowWords];
+            for (int cix : m_RowCols[r]) {
+                const Word *rows = &m_ColRows[cix * m_RowWords];
+                for (std::size_t w = 0; w < m_RowWords; ++w) {
+                    conflicts[w] |= rows[w];
+                }
+            }
+        }
+        m_Prepared = true;
+    }
+
+    // Depth-first search from the state at level first, on an explicit stack like ConstraintMatrix::Solutions().
+    int Search(Stack &stack, int first, int depth) const {
+        int solutions = 0;
+        int level = first;
+        bool backtracking = false;
+        for (;;) {
+            if (!backtracking) {
+                if (!Intersects(stack.uncovered[level], m_ReqColumns)) {
+                    PrintSolution(stack, level);
+                    ++solutions;
+                    backtracking = true;
+                } else {
+                    stack.instrumentation.SetDepth(depth - first + level);
+                    stack.col[level] = ChooseColumn(stack, level);
+                    stack.row[level] = -1;
+                }
+            }
+
+            if (backtracking) {
+                if (level == first) {
+                    break;
+                }
+                --level;
+                stack.instrumentation.SetDepth(depth - first + level);
+            }
+
+            // Move on to the next possibility of this level's constraint.
+            const int r = NextRow(stack, level);
+            if (r < 0) {
+                backtracking = true;
+                continue;
+            }
+            Select(stack, level, r);
+            ++level;
+            backtracking = false;
+        }
+        return solutions;
+    }
+
+    // Search() down to splitDepth levels, recording the selected rows at that depth instead of searching on.
+    int Expand(Stack &stack, int level, int splitDepth, std::vector<Task> &tasks) const {
+        if (!Intersects(stack.uncovered[level], m_ReqColumns)) {
+            PrintSolution(stack, level);
+            return 1;
+        }
+        if (level == splitDepth) {
+            Task &task = tasks.emplace_back();
+            for (int l = 0; l < level; ++l) {
+                task.push_back({stack.col[l], stack.row[l]});
+            }
+            return 0;
+        }
+        stack.instrumentation.SetDepth(level);
+        stack.col[level] = ChooseColumn(stack, level);
+        stack.row[level] = -1;
+        int solutions = 0;
+        for (int r = NextRow(stack, level); r >= 0; r = NextRow(stack, level)) {
+            Select(stack, level, r);
+            solutions += Expand(stack, level + 1, splitDepth, tasks);
+            stack.instrumentation.SetDepth(level);
+        }
+        return solutions;
+    }
+
+    // The uncovered required constraint with the fewest live rows, taking the lowest index on ties.
+    int ChooseColumn(const Stack &stack, int level) const {
+        const Word *live = &stack.live[level * m_RowWords];
+        const ColumnSet &uncovered = stack.uncovered[level];
+        int bestCol = -1;
+        int fewestPossibilities = std::numeric_limits<int>::max();
+        for (std::size_t w = 0; w < k_ColWords; ++w) {
+            for (Word bits = uncovered[w] & m_ReqColumns[w]; bits; bits &= bits - 1) {
+                const int c = static_cast<int>(w * k_WordBits + std::countr_zero(bits));
+                const Word *rows = &m_ColRows[c * m_RowWords];
+                int count = 0;
+                for (std::size_t rw = 0; rw < m_RowWords; ++rw) {
+                    count += std::popcount(rows[rw] & live[rw]);
+                }
+                if (count < fewestPossibilities) {
+                    fewestPossibilities = count;
+                    bestCol = c;
+                    if (count == 0) {
+                        return bestCol;
+                    }
+                }
+            }
+        }
+        return bestCol;
+    }
+
+    // The next live row of this level's constraint after the one selected last, or -1.
+    int NextRow(Stack &stack, int level) const {
+        const Word *live = &stack.live[level * m_RowWords];
+        const Word *rows = &m_ColRows[stack.col[level] * m_RowWords];
+        const std::size_t from = stack.row[level] + 1;
+        Word mask = ~Word{0} << (from % k_WordBits);
+        for (std::size_t w = from / k_WordBits; w < m_RowWords; ++w, mask = ~Word{0}) {
+            const Word bits = rows[w] & live[w] & mask;
+            if (bits) {
+                return stack.row[level] = static_cast<int>(w * k_WordBits + std::countr_zero(bits));
+            }
+        }
+        return stack.row[level] = -1;
+    }
+
+    void Select(Stack &stack, int level, int r) const {
+        stack.row[level] = r;
+        const Word *live = &stack.live[level * m_RowWords];
+        const Word *conflicts = &m_Conflicts[r * m_RowWords];
+        Word *next = &stack.live[(level + 1) * m_RowWords];
+        for (std::size_t w = 0; w < m_RowWords; ++w) {
+            next[w] = live[w] & ~conflicts[w];
+        }
+        for (std::size_t w = 0; w < k_ColWords; ++w) {
+            stack.uncovered[level + 1][w] = stack.uncovered[level][w] & ~m_RowMasks[r][w];
+        }
+        stack.instrumentation.NodeVisited();
+    }
+
+    // Reports each selected row starting from the constraint it was selected for, as ConstraintMatrix does.
+    void PrintSolution(const Stack &stack, int levels) const {
+        if (stack.print) {
+            std::vector<std::vector<std::size_t>> selections;
+            for (int level = 0; level < levels; ++level) {
+                const std::vector<int> &cols = m_RowCols[stack.row[level]];
+                const auto first = std::find(cols.begin(), cols.end(), stack.col[level]);
+                selections.emplace_back(first, cols.end());
+                selections.back().insert(selections.back().end(), cols.begin(), first);
+            }
+            stack.print(selections);
+        }
+    }
+
+    static void SetBit(Word *bits, std::size_t i) { bits[i / k_WordBits] |= Word{1} << (i % k_WordBits); }
+    static void SetBit(ColumnSet &bits, std::size_t i) { SetBit(bits.data(), i); }
+    static bool TestBit(const ColumnSet &bits, std::size_t i) { return bits[i / k_WordBits] >> (i % k_WordBits) & 1; }
+    static bool Intersects(const ColumnSet &a, const ColumnSet &b) {
+        for (std::size_t w = 0; w < k_ColWords; ++w) {
+            if (a[w] & b[w]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    const std::size_t m_NumReqConstraints;
+    const std::size_t m_NumOptConstraints;
+    const std::size_t m_NumTotalConstraints;
+    ColumnSet m_AllColumns{};
+    ColumnSet m_ReqColumns{};
+
+    // The possibilities as added, and as sets of constraints.
+    std::vector<std::vector<int>> m_RowCols;
+    std::vector<ColumnSet> m_RowMasks;
+
+    // Built by Prepare(): the rows of each constraint and the rows each row conflicts with, m_RowWords words apiece.
+    bool m_Prepared = false;
+    std::size_t m_RowWords = 1;
+    std::vector<Word> m_ColRows;
+    std::vector<Word> m_Conflicts;
+
+    PrintFunctionType m_PrintFunction;
+    [[no_unique_address]] t_Instrumentation m_Instrumentation;
+};
+
+// Matrices with at most this many constraints are solved by BitsetMatrix when declared as ExactCover.
+constexpr std::size_t k_BitsetMaxConstraints = 256;
+
+// The exact cover solver for a problem of this size: BitsetMatrix for up to k_BitsetMaxConstraints constraints (at
+// most t_MaxNodes possibilities), ConstraintMatrix for anything wider.
+template <std::size_t t_MaxConstraints, std::size_t t_MaxNodes, typename t_Link = std::uint32_t,
+          typename t_Instrumentation = NullInstrumentation>
+using ExactCover = std::conditional_t<t_MaxConstraints <= k_BitsetMaxConstraints,
+                                      BitsetMatrix<t_MaxConstraints, t_MaxNodes, t_Instrumentation>,
+                                      ConstraintMatrix<t_MaxConstraints, t_MaxNodes, t_Link, t_Instrumentation>>;
@@ -1,256 +1,856 @@
+#pragma once
+
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <cmath>
 #include <cstdint>
-#include <unordered_set>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <functional>
 
-class Instrumentation {
+#if defined(__AVX2__) || defined(__AVX512F__)
+    #include <immintrin.h>
+#endif
+
+#include "Automorphisms.hpp"
+#include "Instrumentation.hpp"
+#include "TranspositionTable.hpp"
+#include "Zdd.hpp"
+
+// TODO - Replace NumConstraints with MaxConstraints
+// template <std::size_t t_Constraints, std::size_t t_MaxNodes, std::size_t t_OptionalConstraints = 0>
+//
+// All nodes live in one array and link to each other by index: node 0 is the root, node c + 1 is the header of
+// constraint c and the nodes of the possibilities follow. t_Link is the width of a link, so a node takes 5 *
+// sizeof(t_Link) bytes (10 for std::uint16_t, 20 for std::uint32_t). t_Instrumentation is one of the policies in
+// Instrumentation.hpp.
+template <std::size_t t_MaxConstraints, std::size_t t_MaxNodes, typename t_Link = std::uint32_t,
+          typename t_Instrumentation = NullInstrumentation>
+class ConstraintMatrix {
+    static_assert(std::is_unsigned_v<t_Link>, "t_Link must be an unsigned integer type");
+    static_assert(1 + t_MaxConstraints + t_MaxNodes <= std::numeric_limits<t_Link>::max(),
+                  "t_Link is too narrow to index t_MaxConstraints + t_MaxNodes nodes");
+
+private:
+    // static constexpr int k_NumConstraints{t_Constraints + t_OptionalConstraints};
+
+    using PrintFunctionType = std::function<void(std::vector<std::vector<std::size_t>>)>;
+
 public:
-    void SetDepth(int depth) {
-        m_Depth = depth;
-        if (m_Depth + 1 > m_Updates.size()) {
-            m_Updates.resize(m_Depth + 1);
-            m_NodesVisited.resize(m_Depth + 1);
+    using Link = t_Link;
+
+    struct Node {
+        Link col;
+
+        Link left;
+        Link right;
+        Link up;
+        Link down;
+    };
+
+    ConstraintMatrix(std::size_t constraints, std::size_t optionalConstraints = 0)
+    // : m_NumConstraints = constraints
+    // , m_OptionalConstraints = optionalConstraints
+    : m_NumReqConstraints(constraints)
+    , m_NumOptConstraints(optionalConstraints)
+    , m_NumTotalConstraints(constraints + optionalConstraints)
+    {
+        ConnectColHeaders();
+        // SplitMix64 of the header index.
+        for (std::size_t h = 0; h < k_HeaderSlots; ++h) {
+            std::uint64_t z = (h + 1) * 0x9E3779B97F4A7C15ull;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            m_ZobristKeys[h] = z ^ (z >> 31);
         }
     }
-    void NodeVisited() { ++m_NodesVisited[m_Depth]; }
-    void Update() { ++m_Updates[m_Depth]; }
-    void PrintResults() {
-        int total = 0;
-        std::int64_t total_updates = 0;
-        std::cout << "Level\tNodes\tUpdates\tUpdates per Node\n";
-        for (int i = 0; i < m_Updates.size(); ++i) {
-            std::cout << i << '\t' << m_NodesVisited[i] << '\t' << m_Updates[i] << '\t'
-                      << float(m_Updates[i]) / m_NodesVisited[i] << '\n';
-            total += m_NodesVisited[i];
-            total_updates += m_Updates[i];
+
+    void SetPrintFunction(PrintFunctionType printFunc) { m_PrintFunction = printFunc; }
+
+    // How ChooseColumn() finds the column with the fewest possibilities.
+    //  Scan        - Reduce over the counts of every header at each search node. Ties go to the leftmost column.
+    //  BucketQueue - Keep the active columns in one list per count, updated by every cover and uncover, so the
+    //                minimum is found without looking at the other columns. Ties go to whichever column entered its
+    //                bucket last, so the search order (but not the solutions) differs from Scan.
+    enum class ColumnSelection { Scan, BucketQueue };
+
+    void SetColumnSelection(ColumnSelection selection) {
+        m_ColumnSelection = selection;
+        if (m_ColumnSelection == ColumnSelection::BucketQueue) {
+            BuildBuckets();
         }
-        std::cout << "Total\t" << total << '\t' << total_updates << '\t' << float(total_updates) / total << '\n';
-    }
-    void Reset() {
-        m_Depth = 0;
-        m_Updates = {0};
-        m_NodesVisited = {0};
     }
 
-private:
-    int m_Depth = 0;
-    std::vector<std::int64_t> m_Updates{0};
-    std::vector<int> m_NodesVisited{0};
-};
+    // Which column the search branches on.
+    //  Fewest             - The one with the fewest possibilities (MRV), found as SetColumnSelection() says.
+    //  First              - The first active one in constraint order, whatever its count.
+    //  Priority           - The one with the lowest of the given priorities, one per required constraint (an
+    //                       organ-pipe order for NQueens, say), whatever its count.
+    //  FewestThenPriority - The one with the fewest possibilities, ties going to the lowest priority.
+    //  FewestThenLength   - The one with the fewest possibilities, ties going to the one whose possibilities had the
+    //                       most constraints in all when the policy was set, which rule out the most other rows.
+    //  FailureWeighted    - The one with the lowest ratio of possibilities to weight (dom/wdeg). Every column starts
+    //                       with weight 1, which goes up by one each time the search fails on it: when it is chosen
+    //                       with no possibilities left, or propagation finds it empty. Weights carry over from one
+    //                       search to the next, see FailureWeights().
+    // Every policy but Fewest scans the active columns, and ties left after the policy go to the leftmost column.
+    // SetRandomization() and multiplicities choose their own way.
+    enum class Branching { Fewest, First, Priority, FewestThenPriority, FewestThenLength, FailureWeighted };
+
+    void SetBranching(Branching branching, const std::vector<int> &priorities = {}) {
+        m_Branching = branching;
+        m_ColumnRanks.assign(k_HeaderSlots, 0);
+        if (branching == Branching::FailureWeighted) {
+            m_FailureWeights.assign(k_HeaderSlots, 1);
+        }
+        if (branching == Branching::Priority || branching == Branching::FewestThenPriority) {
+            assert(priorities.size() == m_NumReqConstraints);
+            for (std::size_t c = 0; c < m_NumReqConstraints; ++c) {
+                m_ColumnRanks[HeaderOf(c)] = priorities[c];
+            }
+        } else if (branching == Branching::FewestThenLength) {
+            for (Link h = m_Nodes[k_Root].right; h != k_Root; h = m_Nodes[h].right) {
+                for (Link j = m_Nodes[h].down; j != h; j = m_Nodes[j].down) {
+                    for (Link k = m_Nodes[j].right; k != j; k = m_Nodes[k].right) {
+                        --m_ColumnRanks[h];
+                    }
+                }
+            }
+        }
+    }
 
-Instrumentation g_Instrumentation;
+    // Branching::FailureWeighted's weight of every required constraint, to seed SetFailureWeights() of a later run (of
+    // the same or a similar matrix) with what this one learned.
+    std::vector<std::uint32_t> FailureWeights() const {
+        assert(m_Branching == Branching::FailureWeighted);
+        std::vector<std::uint32_t> weights(m_NumReqConstraints);
+        for (std::size_t c = 0; c < m_NumReqConstraints; ++c) {
+            weights[c] = m_FailureWeights[HeaderOf(c)];
+        }
+        return weights;
+    }
+    void SetFailureWeights(const std::vector<std::uint32_t> &weights) {
+        assert(m_Branching == Branching::FailureWeighted && weights.size() == m_NumReqConstraints);
+        for (std::size_t c = 0; c < m_NumReqConstraints; ++c) {
+            m_FailureWeights[HeaderOf(c)] = std::max(weights[c], 1u);
+        }
+    }
 
-class Header;
-class Node {
-public:
-    inline void Remove();
-    inline void Restore();
+    // Let Solutions() propagate after every selection: a required constraint left with no possibilities fails the
+    // branch at once, and one left with a single possibility has it selected on the spot, without a search level or a
+    // column choice of its own. Forced selections and early failures are reported to m_Instrumentation rather than
+    // counted as nodes. Not supported with multiplicities or decomposition.
+    void SetPropagation(bool enabled) {
+        assert(!enabled || (m_Bounds.empty() && m_NogoodCapacity == 0 && m_DecompositionDepth < 0));
+        m_Propagation = enabled;
+    }
 
-    Header *col;
+    // Let Solutions() break ties between the columns with the fewest possibilities at random, and try the possibilities
+    // of every column in a random order, both drawn from a generator started at seed. The same seed on the same matrix
+    // gives the same search on every platform. Seed 0 goes back to the deterministic order. Random ties replace the
+    // column selection policy. Not supported with multiplicities.
+    void SetRandomization(std::uint64_t seed) {
+        assert(seed == 0 || m_Bounds.empty());
+        m_Randomized = seed != 0;
+        m_RandomState = seed;
+        m_OrderedRows = m_Randomized || m_RowOrdering != RowOrdering::Insertion;
+    }
 
-    Node *left;
-    Node *right;
-    Node *up;
-    Node *down;
-};
+    // The order in which Solutions() tries the possibilities of the column it branches on.
+    //  Insertion         - The order they were added in.
+    //  LeastConstraining - Fewest possibilities of the other constraints ruled out first: the sum of the counts of
+    //                      the row's other constraints once the column is covered.
+    //  MostCovering      - Most required constraints covered first, which closes the most columns at once.
+    // Orders other than Insertion sort every level's possibilities onto a buffer as the level is entered, so the links
+    // are never reordered; ties keep the insertion order, or the random one under SetRandomization(). Not supported
+    // with multiplicities.
+    enum class RowOrdering { Insertion, LeastConstraining, MostCovering };
 
-class Header : public Node {
-public:
-    void Remove() {
-        right->left = left;
-        left->right = right;
-        g_Instrumentation.Update();
+    void SetRowOrdering(RowOrdering ordering) {
+        assert(ordering == RowOrdering::Insertion || m_Bounds.empty());
+        m_RowOrdering = ordering;
+        m_OrderedRows = m_Randomized || m_RowOrdering != RowOrdering::Insertion;
     }
-    void Restore() {
-        left->right = this;
-        right->left = this;
+
+    // Let Solutions() stop at the first solution it finds, returning 1 (or 0 if there is none), also when merged
+    // duplicates make that solution stand for several. With restartNodes, it also gives up on a search that has
+    // branched on more than restartNodes times the next term of the Luby sequence (1, 1, 2, 1, 1, 2, 4, ...) columns
+    // without a solution, and starts over from the top; under SetRandomization(), every restart makes different
+    // choices. The budgets keep growing, so a matrix without solutions still returns 0.
+    // Not supported with nogood learning, decomposition or DetectSymmetries().
+    void SetFirstSolution(bool enabled, std::uint64_t restartNodes = 0) {
+        assert(!enabled || (m_NogoodCapacity == 0 && m_DecompositionDepth < 0 && m_Symmetries.empty()));
+        m_FirstSolution = enabled;
+        m_RestartNodes = enabled ? restartNodes : 0;
     }
-    void Cover() {
-        // Remove c from header list
-        Remove();
-        // Remove all rows from c from other columns that they are in
-        for (Node *i = down; i != this; i = i->down) {
-            for (Node *j = i->right; j != i; j = j->right) {
-                j->Remove();
+    // Restarts made by the last Solutions().
+    std::uint64_t Restarts() const { return m_Restarts; }
+
+    // Knuth's estimate of the tree Solutions() would search from the current state of the matrix, from samples random
+    // paths from the root to a leaf. Each path branches like the search (same column choice, and propagation if it is
+    // on) on one possibility drawn uniformly from those of the column, and stands for the whole tree as if every node
+    // of its level had as many children as the one it went through. The mean over the paths is an unbiased estimate of
+    // the nodes, updates (as counted by the instrumentation policy, so always 0 with NullInstrumentation) and solutions
+    // of the full search; the interval is the mean plus or minus 1.96 standard errors, which heavy-tailed trees make
+    // too narrow at small sample sizes. Leaves the matrix, the instrumentation, SetRandomization() and the failure
+    // weights as they were. Decomposition and other searches that do not branch like Solutions() are not taken into
+    // account. Not supported with multiplicities.
+    struct TreeEstimate {
+        struct Measure {
+            double mean = 0;
+            double low = 0;
+            double high = 0;
+        };
+        Measure nodes;
+        Measure updates;
+        Measure solutions;
+    };
+    TreeEstimate Estimate(std::size_t samples, std::uint64_t seed = 1) {
+        // Rows fixed by Reduce() are no longer selected, and count through m_FixedCopies.
+        assert(samples > 0 && m_Bounds.empty() && m_Solution.empty());
+        const t_Instrumentation instrumentation = m_Instrumentation;
+        const std::vector<std::uint32_t> failureWeights = m_FailureWeights;
+        const std::uint64_t randomState = std::exchange(m_RandomState, seed);
+        const bool propagating = std::exchange(m_Propagating, m_Propagation);
+        std::array<double, 3> sums{}, squares{};
+        for (std::size_t i = 0; i < samples; ++i) {
+            const std::array<double, 3> probe = Probe();
+            for (std::size_t k = 0; k < probe.size(); ++k) {
+                sums[k] += probe[k];
+                squares[k] += probe[k] * probe[k];
             }
         }
+        m_Propagating = propagating;
+        m_RandomState = randomState;
+        m_Instrumentation = instrumentation;
+        m_FailureWeights = failureWeights;
+
+        std::array<typename TreeEstimate::Measure, 3> measures;
+        const double n = static_cast<double>(samples);
+        for (std::size_t k = 0; k < measures.size(); ++k) {
+            const double mean = sums[k] / n;
+            const double variance = samples > 1 ? std::max(squares[k] - n * mean * mean, 0.0) / (n - 1) : 0;
+            const double margin = 1.96 * std::sqrt(variance / n);
+            measures[k] = {mean, std::max(mean - margin, 0.0), mean + margin};
+        }
+        return {measures[0], measures[1], measures[2]};
     }
-    void UnCover() {
-        // Reverse operation of cover
-        for (Node *i = up; i != this; i = i->up) {
-            for (Node *j = i->left; j != i; j = j->left) {
-                j->Restore();
+
+    // Let Solutions() learn from the subtrees that turn out to have no solutions. When every possibility of a level's
+    // constraint has failed, the rows selected above it that caused the failures (those that hid the constraint's
+    // other possibilities, and those behind the failures of the possibilities tried) form a nogood: no solution
+    // selects all of them. Nogoods of up to k_MaxNogoodRows rows are kept in a store of capacity entries, and a later
+    // branch that would complete one is skipped. When the store is full the next nogood replaces the oldest one that
+    // has not pruned a branch since the last replacement went past it. capacity 0 turns learning off. Call once the
+    // matrix is built (and reduced); only the possibilities in the matrix at that point are taken into account. Not
+    // supported with colors, multiplicities, propagation, solution symmetries or SetFirstSolution().
+    void SetNogoodLearning(std::size_t capacity) {
+        assert(m_Colors.empty() && m_Bounds.empty() && !m_Propagation && m_Solution.empty());
+        assert(capacity == 0 || (m_SolutionSymmetries.empty() && !m_FirstSolution));
+        m_NogoodCapacity = capacity;
+        m_Nogoods.clear();
+        m_NogoodHand = 0;
+        m_NogoodStats = {};
+        if (capacity == 0) {
+            return;
+        }
+        const std::size_t nodes = k_FirstNode + m_NodeCount;
+        const std::vector<Link> rowOf = FirstNodeOfRows();
+        m_RowOf.assign(k_FirstNode, k_Root);
+        m_RowOf.insert(m_RowOf.end(), rowOf.begin(), rowOf.end());
+        m_ColumnRows.assign(k_HeaderSlots, {});
+        for (Link h = m_Nodes[k_Root].right; h != k_Root; h = m_Nodes[h].right) {
+            for (Link j = m_Nodes[h].down; j != h; j = m_Nodes[j].down) {
+                m_ColumnRows[h].push_back(j);
             }
         }
-        Restore();
+        m_CoveredBy.assign(k_HeaderSlots, -1);
+        m_NogoodWatches.assign(nodes, {});
+        m_SelectedAt.assign(nodes, -1);
+        // m_Solution never holds more rows than there are levels.
+        m_ConflictWords = (m_Levels.size() + 63) / 64;
+        m_LevelConflicts.assign(m_Levels.size() * m_ConflictWords, 0);
+        m_LevelSolutions.assign(m_Levels.size(), 0);
+        m_LevelBranched.assign(m_Levels.size(), 0);
     }
 
-    void Append(Node *node) {
-        // Insert node into column (at lowest position)
-        node->col = this;
-        node->down = this;
-        node->up = up;
-        up->down = node;
-        up = node;
-        ++count;
+    struct NogoodStats {
+        std::uint64_t learned = 0;
+        // Branches skipped because they completed a nogood.
+        std::uint64_t pruned = 0;
+        std::uint64_t evicted = 0;
+    };
+    const NogoodStats &LearningStats() const { return m_NogoodStats; }
+
+    // Find the symmetries of the matrix in its current state: the permutations of its constraints (required to
+    // required, optional to optional) that map the live possibilities onto live possibilities of the same multiplicity,
+    // found by an AutomorphismSearch over the graph of constraints and possibilities. From then on Solutions() breaks
+    // them: it branches on a constraint that as many symmetries as possible leave in place, only tries the first
+    // possibility of every orbit of those symmetries, and counts it once per possibility in the orbit. Below the
+    // possibility it goes on with the symmetries that also leave it in place. Only one solution per orbit is reported.
+    // Returns the order of the group, 1 if it is trivial or has more than k_MaxSymmetries elements (then nothing is
+    // broken). Not supported with colors, multiplicities or decomposition, nor by SolutionsParallel(), whose workers
+    // search below prefixes that the group does not leave in place.
+    std::size_t DetectSymmetries() {
+        assert(m_Colors.empty() && m_Bounds.empty() && m_Solution.empty() && m_DecompositionDepth < 0);
+        m_Symmetries.clear();
+
+        // Vertices: the constraints (by header slot, the branch vertices) and then the live possibilities. Rows are
+        // reached through the required constraints in the header list and the optional constraints they claim.
+        const std::vector<Link> rowOf = FirstNodeOfRows();
+        m_SymmetryRowOf.assign(k_FirstNode + m_NodeCount, 0);
+        m_SymmetryRows.clear();
+        std::vector<char> reached(m_NodeCount, 0);
+        // The vertex of every header slot in use: the required constraints in the header list and the optional ones
+        // their rows claim.
+        std::vector<AutomorphismSearch::Vertex> vertexOf(k_HeaderSlots, 0);
+        std::vector<Link> headers;
+        const auto addHeader = [&](Link h) {
+            if (vertexOf[h] == 0) {
+                headers.push_back(h);
+                vertexOf[h] = static_cast<AutomorphismSearch::Vertex>(headers.size());
+            }
+        };
+        for (Link h = m_Nodes[k_Root].right; h != k_Root; h = m_Nodes[h].right) {
+            addHeader(h);
+            for (Link j = m_Nodes[h].down; j != h; j = m_Nodes[j].down) {
+                const Link first = rowOf[j - k_FirstNode];
+                if (reached[first - k_FirstNode]) {
+                    continue;
+                }
+                reached[first - k_FirstNode] = 1;
+                m_SymmetryRowOf[first] = static_cast<std::uint32_t>(m_SymmetryRows.size());
+                m_SymmetryRows.push_back(first);
+                Link k = first;
+                do {
+                    if (m_Nodes[k].col > m_NumReqConstraints) {
+                        addHeader(m_Nodes[k].col);
+                    }
+                    k = m_Nodes[k].right;
+                } while (k != first);
+            }
+        }
+        for (Link n = static_cast<Link>(k_FirstNode); n < k_FirstNode + m_NodeCount; ++n) {
+            m_SymmetryRowOf[n] = m_SymmetryRowOf[rowOf[n - k_FirstNode]];
+        }
+
+        // Constraints first (the branch vertices), colored 0 if required and 1 if optional, then the rows, colored by
+        // their multiplicity above that.
+        const std::size_t numHeaders = headers.size();
+        std::vector<std::vector<AutomorphismSearch::Vertex>> neighbors(numHeaders + m_SymmetryRows.size());
+        std::vector<AutomorphismSearch::Vertex> colors(neighbors.size());
+        for (std::size_t v = 0; v < numHeaders; ++v) {
+            colors[v] = headers[v] > m_NumReqConstraints;
+        }
+        for (std::size_t r = 0; r < m_SymmetryRows.size(); ++r) {
+            const auto vertex = static_cast<AutomorphismSearch::Vertex>(numHeaders + r);
+            colors[vertex] = static_cast<AutomorphismSearch::Vertex>(1 + Multiplicity(m_SymmetryRows[r]));
+            Link k = m_SymmetryRows[r];
+            do {
+                const AutomorphismSearch::Vertex header = vertexOf[m_Nodes[k].col] - 1;
+                neighbors[vertex].push_back(header);
+                neighbors[header].push_back(vertex);
+                k = m_Nodes[k].right;
+            } while (k != m_SymmetryRows[r]);
+        }
+
+        AutomorphismSearch search(std::move(neighbors), colors, numHeaders);
+        for (const AutomorphismSearch::Permutation &permutation : search.Run(k_MaxSymmetries)) {
+            Symmetry &symmetry = m_Symmetries.emplace_back();
+            symmetry.columns.resize(k_HeaderSlots);
+            for (std::size_t h = 0; h < k_HeaderSlots; ++h) {
+                symmetry.columns[h] = static_cast<Link>(h);
+            }
+            for (std::size_t v = 0; v < numHeaders; ++v) {
+                symmetry.columns[headers[v]] = headers[permutation[v]];
+            }
+            for (std::size_t r = 0; r < m_SymmetryRows.size(); ++r) {
+                symmetry.rows.push_back(static_cast<std::uint32_t>(permutation[numHeaders + r] - numHeaders));
+            }
+        }
+        if (m_Symmetries.size() <= 1) {
+            m_Symmetries.clear();
+            return 1;
+        }
+        return m_Symmetries.size();
     }
 
-    int count;
-    std::size_t ix;     // DEBUG
-};
+    // Report only the canonical solution of every class of solutions that permutations (each the image of every
+    // constraint, required to required and optional to optional, and mapping solutions to solutions) carry into each
+    // other. Solutions are compared as the list, in constraint order, of the smallest constraint of the possibility
+    // that covers each constraint, and a solution is canonical if no permutation maps it to a smaller one. Pass the
+    // whole group: with only some of its elements, a class may be reported more than once. Solutions() and
+    // SolutionsParallel() count the canonical solutions only; the check runs on complete solutions, so the search
+    // still visits every solution of each class. Empty permutations turns it off.
+    // Not supported with multiplicities, decomposition, nogood learning, DetectSymmetries() or after Reduce() selected
+    // possibilities.
+    void SetSolutionSymmetries(const std::vector<std::vector<std::size_t>> &permutations) {
+        assert(permutations.empty() || (m_Bounds.empty() && m_DecompositionDepth < 0 && m_NogoodCapacity == 0 &&
+                                        m_Symmetries.empty() && m_FixedSelections.empty()));
+        m_SolutionSymmetries.clear();
+        for (const std::vector<std::size_t> &permutation : permutations) {
+            assert(permutation.size() == m_NumTotalConstraints);
+            std::vector<Link> image(k_HeaderSlots, k_Root);
+            bool identity = true;
+            for (std::size_t c = 0; c < m_NumTotalConstraints; ++c) {
+                assert((c < m_NumReqConstraints) == (permutation[c] < m_NumReqConstraints));
+                image[HeaderOf(c)] = HeaderOf(permutation[c]);
+                identity &= permutation[c] == c;
+            }
+            if (!identity) {
+                m_SolutionSymmetries.push_back(std::move(image));
+            }
+        }
+        m_CanonicalLabels.assign(k_HeaderSlots, k_Root);
+        m_ImageLabels.assign(k_HeaderSlots, k_Root);
+    }
 
-inline void Node::Remove() {
-    up->down = down;
-    down->up = up;
-    --col->count;
-    assert(col->count >= 0);
-    g_Instrumentation.Update();
-}
+    // Depth-first search for every solution from the current state of the matrix. The search runs on an explicit
+    // stack (m_Levels) rather than recursing once per selected row. depth is only used to offset the levels reported
+    // to m_Instrumentation.
+    int Solutions(int depth = 0) {
+        if (depth == 0) {
+            m_Instrumentation.Reset();
+            m_Decompositions = 0;
+        }
+        if (!m_Symmetries.empty() && !m_BreakingSymmetry) {
+            std::vector<std::uint32_t> group(m_Symmetries.size());
+            for (std::size_t g = 0; g < group.size(); ++g) {
+                group[g] = static_cast<std::uint32_t>(g);
+            }
+            m_BreakingSymmetry = true;
+            const auto solutions = static_cast<int>(SolutionsSymmetric(group, depth));
+            m_BreakingSymmetry = false;
+            return solutions;
+        }
+        if (m_DecompositionDepth >= 0) {
+            assert(m_Bounds.empty());
+            // SolutionsDecomposed() counts from here on, so the rows already selected (a worker's prefix, or the
+            // rows Reduce() fixed) are counted here.
+            return static_cast<int>(Copies() * SolutionsDecomposed(depth, nullptr));
+        }
 
-inline void Node::Restore() {
-    ++col->count;
-    down->up = this;
-    up->down = this;
-}
+        const bool propagating = std::exchange(m_Propagating, m_Propagation);
+        int solutions = 0;
+        int level = 0;
+        bool backtracking = false;
+        // Under SetFirstSolution(): the columns the current run may still branch on before it restarts.
+        std::uint64_t budget = m_RestartNodes * Luby(1);
+        m_Restarts = 0;
+        for (;;) {
+            if (!backtracking) {
+                // Check if already satisfied.
+                if (m_Nodes[k_Root].right == k_Root) {
+                    if (IsCanonical()) {
+                        PrintSolution();
+                        if (m_FirstSolution) {
+                            // One solution, however many copies of it merged duplicates stand for.
+                            solutions = 1;
+                            Unwind(level);
+                            break;
+                        }
+                        solutions += static_cast<int>(Copies());
+                    }
+                    backtracking = true;
+                } else if (m_RestartNodes != 0 && budget-- == 0) {
+                    Unwind(level);
+                    level = 0;
+                    budget = m_RestartNodes * Luby(++m_Restarts + 1);
+                    continue;
+                } else {
+                    Link bestCol = ChooseColumn();
 
-// TODO - Replace NumConstraints with MaxConstraints
-// template <std::size_t t_Constraints, std::size_t t_MaxNodes, std::size_t t_OptionalConstraints = 0>
-template <std::size_t t_MaxConstraints, std::size_t t_MaxNodes>
-class ConstraintMatrix {
-private:
-    // static constexpr int k_NumConstraints{t_Constraints + t_OptionalConstraints};
+                    // PrintColCounts();
+                    // std::cout << "Covering col " << bestCol - 1 << " with " << m_Counts[bestCol] << " nodes\n";
 
-    using PrintFunctionType = std::function<void(std::vector<std::vector<std::size_t>>)>;
+                    // Consider constraint satisfied and iterate through its possibilities.
+                    m_Instrumentation.SetDepth(depth + level);
+                    EnterColumn(m_Levels[level], bestCol);
+                    if (m_NogoodCapacity != 0) {
+                        std::fill_n(LevelConflict(level), m_ConflictWords, 0);
+                        m_LevelSolutions[level] = solutions;
+                        m_LevelBranched[level] = false;
+                    }
+                }
+            }
 
-public:
-    ConstraintMatrix(std::size_t constraints, std::size_t optionalConstraints = 0) 
-    // : m_NumConstraints = constraints
-    // , m_OptionalConstraints = optionalConstraints
-    : m_NumReqConstraints(constraints)
-    , m_NumOptConstraints(optionalConstraints)
-    , m_NumTotalConstraints(constraints + optionalConstraints)
-    { ConnectColHeaders(); }
+            if (backtracking) {
+                if (level == 0) {
+                    break;
+                }
+                --level;
+                m_Instrumentation.SetDepth(depth + level);
+                Unbranch(m_Levels[level]);
+            }
 
-    void SetPrintFunction(PrintFunctionType printFunc) { m_PrintFunction = printFunc; }
+            // Move on to the next possibility of this level's constraint.
+            SearchLevel &sl = m_Levels[level];
+            bool branch = NextPossibility(sl);
+            while (branch && m_NogoodCapacity != 0 && Pruned(level, sl.row)) {
+                branch = NextPossibility(sl);
+            }
+            if (!branch) {
+                LeaveColumn(sl);
+                if (m_NogoodCapacity != 0 && solutions == m_LevelSolutions[level]) {
+                    LearnFrom(level);
+                }
+                backtracking = true;
+                continue;
+            }
+            const bool consistent = Branch(sl);
+            if (m_NogoodCapacity != 0) {
+                m_LevelBranched[level] = true;
+            }
+            ++level;
+            // A failed propagation backtracks into this level like any other finished branch.
+            backtracking = !consistent;
+        }
 
-    int Solutions(int depth = 0) {
         if (depth == 0) {
-            g_Instrumentation.Reset();
+            // m_Instrumentation.PrintResults();
         }
 
-        // Check if already satisfied.
-        if (m_RootNode.right == &m_RootNode) {
-            PrintSolution();
-            return 1;
+        m_Propagating = propagating;
+        return solutions;
+    }
+
+    // Counts (and reports) the same solutions as Solutions() using numThreads workers (0 = one per hardware thread).
+    // Every worker searches its own replica of the matrix. Work is handed over as a prefix of selected rows, which the
+    // receiving worker replays before searching on. The first stealDepth levels of every search publish their
+    // unexplored rows so that idle workers can steal them. The print function may be called from any worker, but never
+    // concurrently.
+    int SolutionsParallel(unsigned numThreads = 0, int stealDepth = k_DefaultStealDepth) {
+        // Replaying a prefix assumes every constraint is covered exactly once, and nothing is left of a symmetry group
+        // below a prefix.
+        assert(m_Bounds.empty() && !m_FirstSolution && m_Symmetries.empty());
+        if (numThreads == 0) {
+            numThreads = std::max(1u, std::thread::hardware_concurrency());
         }
 
-#if 1
-        // Find constraint (col) with fewest possibilities
-        Header *bestCol = nullptr;
-        int fewestPossibilities = t_MaxNodes;
-        for (Header *colH = reinterpret_cast<Header *>(m_RootNode.right); colH != &m_RootNode;
-             colH = reinterpret_cast<Header *>(colH->right)) {
-            if (colH->count < fewestPossibilities) {
-                fewestPossibilities = colH->count;
-                bestCol = colH;
+        ParallelSearch search;
+        search.stealDepth = std::max(stealDepth, 1);
+        for (unsigned i = 0; i < numThreads; ++i) {
+            auto worker = std::make_unique<Worker>();
+            // Links are indices, so a plain copy is a complete replica.
+            worker->matrix = std::make_unique<ConstraintMatrix>(*this);
+            worker->levels.resize(search.stealDepth);
+            if (m_PrintFunction) {
+                worker->matrix->m_PrintFunction = [this, &search](std::vector<std::vector<std::size_t>> selections) {
+                    std::lock_guard lock(search.printMutex);
+                    if (m_PrintFunction) {
+                        m_PrintFunction(std::move(selections));
+                    }
+                };
             }
+            search.workers.push_back(std::move(worker));
         }
-        assert(fewestPossibilities >= 0);
-#else
-        // Set bestCol to the first col right of root node.
-        Header *bestCol = reinterpret_cast<Header *>(m_RootNode.right);
-#endif
 
-#if 0
-        // This does not modify the algorithm. We will also find 0 solutions if we proceed.
-        // It does decrease the number of "Updates" measured in finding solutions.
-        // It is hard to know if this is grants an improvement on performance.
-        if (bestCol->count == 0) {
-            // Unsatisfiable
-            return 0;
+        // Worker 0 starts with the whole tree (an empty prefix), everyone else starts by stealing.
+        search.busy = 1;
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < numThreads; ++i) {
+            threads.emplace_back([&search, i] { RunWorker(search, i); });
         }
-#endif
 
-        // PrintColCounts();
-        // std::cout << "Covering col " << bestCol->ix << " which contains " << bestCol->count << " nodes\n";
+        int solutions = 0;
+        m_Instrumentation.Reset();
+        for (unsigned i = 0; i < numThreads; ++i) {
+            threads[i].join();
+            solutions += search.workers[i]->solutions;
+            m_Instrumentation.Merge(search.workers[i]->matrix->m_Instrumentation);
+        }
+        return solutions;
+    }
+
+    // Let Solutions() look for independent parts of the matrix at every search node up to maxDepth levels below where
+    // it starts (-1, the default, never does): groups of required constraints that no possibility connects, directly
+    // or through optional constraints. Every part is then solved on its own and their counts multiplied. With a print
+    // function, the solutions of the parts are kept and every combination of them is reported. Finding the parts
+    // walks every live node, so it only pays off near the root. Not supported with multiplicities or propagation.
+    void SetDecompositionDepth(int maxDepth) {
+        assert(maxDepth < 0 || (m_Bounds.empty() && !m_Propagation));
+        m_DecompositionDepth = maxDepth;
+        m_ComponentMarks.assign(k_HeaderSlots, 0);
+        m_ComponentStamp = 0;
+    }
 
-        // Consider constraint satisfied and iterate through its possibilities.
-        g_Instrumentation.SetDepth(depth);
-        bestCol->Cover();
+    // How many times the last Solutions() split the matrix into independent parts.
+    std::uint64_t Decompositions() const { return m_Decompositions; }
 
-        // PrintColCounts();
-        // getchar();
+    // Counts the solutions without reporting them. Subtree counts are cached by the set of covered constraints in a
+    // TranspositionTable of at most tableBytes, so a subproblem that the search reaches again by selecting the same
+    // rows in another order (or other rows covering the same constraints) is only counted once while it stays cached.
+    // Colors and multiplicities are not supported.
+    std::uint64_t CountSolutions(std::size_t tableBytes = k_DefaultTableBytes) {
+        assert(m_Colors.empty() && m_Bounds.empty());
+        m_Instrumentation.Reset();
+        TranspositionTable table(tableBytes);
+        std::uint64_t work = 0;
+        const std::uint64_t solutions = m_FixedCopies * CountSolutions(table, 0, work);
+        m_TableStats = table.GetStats();
+        return solutions;
+    }
 
-        int solutions = 0;
-        for (Node *r = bestCol->down; r != bestCol; r = r->down) {
-            Select(r);
-            solutions += Solutions(depth + 1);
-            g_Instrumentation.SetDepth(depth);
-            UnSelect(r);
-        }
-        bestCol->UnCover();
+    // Hits and misses of the transposition table of the last CountSolutions().
+    const TranspositionTable::Stats &TableStats() const { return m_TableStats; }
 
-        if (depth == 0) {
-            // g_Instrumentation.PrintResults();
+    // Knuth's DXZ: the same search as Solutions(), building a ZDD of every solution instead of reporting them. The
+    // subproblem below a search node only depends on which constraints are covered, so the ZDD of every subproblem is
+    // remembered under that set and reused whenever the search gets there again. Possibilities are numbered in the
+    // order they were added, and merged duplicates only appear as the possibility they were merged into, which the
+    // ZDD counts once per copy, as Solutions() does. Colors and multiplicities are not supported.
+    Zdd SolutionsZdd() {
+        assert(m_Colors.empty() && m_Bounds.empty());
+        m_Instrumentation.Reset();
+
+        ZddSearch search;
+        search.covered.assign((m_NumTotalConstraints + 63) / 64, 0);
+        const std::vector<Link> rowOf = FirstNodeOfRows();
+        search.possibility.resize(m_NodeCount);
+        int possibility = -1;
+        for (int i = 0; i < m_NodeCount; ++i) {
+            if (rowOf[i] == k_FirstNode + i) {
+                ++possibility;
+                if (!m_Multiplicity.empty()) {
+                    search.zdd.m_Copies.push_back(m_Multiplicity[rowOf[i]]);
+                }
+            }
+            search.possibility[i] = possibility;
         }
+        search.zdd.m_FixedCopies = m_FixedCopies;
 
-        return solutions;
+        search.zdd.m_Root = SolutionsZdd(search, 0);
+        return std::move(search.zdd);
+    }
+
+    // colors is either empty or holds a color for each constraint. A possibility may claim an optional constraint with
+    // a color (> 0) instead of outright (0), and then it is compatible with every other possibility claiming it with
+    // the same color.
+    void AddPossibility(const std::vector<int> &constraints, const std::vector<int> &colors = {}) {
+        const std::size_t offsets[] = {0, constraints.size()};
+        AddPossibilities(offsets, constraints, colors);
     }
 
-    void AddPossibility(const std::vector<int> &constraints) {
-        Node *rightmost = nullptr;
-        for (int cix : constraints) {
-#if 1
-            // Check for duplciates
-            std::unordered_set<int> seen;
-            for (int num : constraints) {
-                if (seen.find(num) != seen.end()) {
-                    // Found a duplicate
-                    assert(false);
+    // Add many possibilities at once, in compressed sparse row form: possibility r claims constraints[offsets[r]] up to
+    // (not including) constraints[offsets[r + 1]], with the colors at the same positions of colors if it is not empty
+    // (see AddPossibility()). Each possibility is checked for repeated and out of range constraints with a bitmap that
+    // is cleared behind it, and its nodes are laid out next to each other and linked in one sweep.
+    void AddPossibilities(std::span<const std::size_t> offsets, std::span<const int> constraints,
+                          std::span<const int> colors = {}) {
+        assert(!offsets.empty() && offsets.front() == 0 && offsets.back() == constraints.size());
+        assert(colors.empty() || colors.size() == constraints.size());
+        assert(m_NodeCount + constraints.size() <= t_MaxNodes);
+        if (!colors.empty() && m_Colors.empty()) {
+            m_Colors.assign(k_FirstNode + t_MaxNodes, 0);
+        }
+#ifndef NDEBUG
+        m_RowBitmap.resize((m_NumTotalConstraints + 63) / 64);
+#endif
+        for (std::size_t r = 0; r + 1 < offsets.size(); ++r) {
+            const std::size_t begin = offsets[r], size = offsets[r + 1] - begin;
+            assert(offsets[r + 1] >= begin);
+            const Link first = static_cast<Link>(k_FirstNode + m_NodeCount);
+            for (std::size_t k = 0; k < size; ++k) {
+                const int cix = constraints[begin + k];
+#ifndef NDEBUG
+                assert(cix >= 0 && static_cast<std::size_t>(cix) < m_NumTotalConstraints);
+                std::uint64_t &word = m_RowBitmap[cix / 64];
+                assert(!(word >> (cix % 64) & 1));
+                word |= std::uint64_t{1} << (cix % 64);
+#endif
+                const Link node = static_cast<Link>(first + k);
+                Append(HeaderOf(cix), node);
+                m_Nodes[node].left = static_cast<Link>(k == 0 ? first + size - 1 : node - 1);
+                m_Nodes[node].right = static_cast<Link>(k == size - 1 ? first : node + 1);
+                if (!colors.empty()) {
+                    assert(colors[begin + k] >= 0);
+                    assert(colors[begin + k] == 0 || static_cast<std::size_t>(cix) >= m_NumReqConstraints);
+                    m_Colors[node] = colors[begin + k];
                 }
-                seen.insert(num);
+            }
+#ifndef NDEBUG
+            for (std::size_t k = 0; k < size; ++k) {
+                m_RowBitmap[constraints[begin + k] / 64] = 0;
             }
 #endif
-            assert(m_NodeCount < t_MaxNodes);
-            assert(cix < m_NumTotalConstraints);
-
-            Node *node = &m_Nodes[m_NodeCount++];
-            m_Headers[cix].Append(node);
-
-            // if (cix == 62) {
-            //     static int count = 0;
-            //     ++count;
-            //     std::cout << "62 has " << count << " constraints.\n";
-            // }
-
-            // Connect node to neighbours left & right
-            if (rightmost) {
-                Node *leftmost = rightmost->right;
-                node->left = rightmost;
-                node->right = leftmost;
-                leftmost->left = node;
-                rightmost->right = node;
-            } else {
-                // No other entries on given row, connect to self
-                node->left = node;
-                node->right = node;
+            m_NodeCount += static_cast<int>(size);
+        }
+    }
+
+    void RemoveConstraint(int cix) { RemoveHeader(HeaderOf(cix)); }
+
+    // What the last search reported to the instrumentation policy (every worker's share for SolutionsParallel()).
+    const t_Instrumentation &Instrumentation() const { return m_Instrumentation; }
+
+    // Merge every possibility that claims the same constraints (with the same colors) as an earlier one into it. The
+    // search then tries each group once and counts it once per member: solution counts do not change and the print
+    // function is still called once per solution, but the copies are only made when reporting. Call after adding
+    // every possibility and before searching. Returns how many possibilities were merged away. Not supported with
+    // multiplicities, under which duplicates may be selected together.
+    std::size_t MergeDuplicatePossibilities() {
+        assert(m_Bounds.empty());
+        if (m_Multiplicity.empty()) {
+            m_Multiplicity.assign(k_FirstNode + t_MaxNodes, 1);
+        }
+        std::map<std::vector<std::pair<Link, int>>, Link> firstOfGroup;
+        std::size_t merged = 0;
+        const std::vector<Link> rowOf = FirstNodeOfRows();
+        for (int i = 0; i < m_NodeCount; ++i) {
+            const Link n = static_cast<Link>(k_FirstNode + i);
+            if (rowOf[i] != n || m_Multiplicity[n] == 0) {
+                continue;
+            }
+            std::vector<std::pair<Link, int>> key;
+            Link j = n;
+            do {
+                key.emplace_back(m_Nodes[j].col, m_Colors.empty() ? 0 : m_Colors[j]);
+                j = m_Nodes[j].right;
+            } while (j != n);
+            std::sort(key.begin(), key.end());
+
+            const auto [it, added] = firstOfGroup.try_emplace(std::move(key), n);
+            if (added) {
+                continue;
             }
-            rightmost = node;
+            do {
+                RemoveNode(j);
+                m_Multiplicity[j] = 0;
+                j = m_Nodes[j].right;
+            } while (j != n);
+            j = it->second;
+            do {
+                ++m_Multiplicity[j];
+                j = m_Nodes[j].right;
+            } while (j != it->second);
+            ++merged;
+        }
+        return merged;
+    }
+
+    // Let a required constraint be satisfied by between lower and upper of the selected possibilities (exactly once by
+    // default), as in Knuth's Algorithm M. Each combination of possibilities is reported once, in any order. Not
+    // supported with propagation, nogood learning, SetRandomization(), row orderings, decomposition, solution
+    // symmetries, DetectSymmetries() or MergeDuplicatePossibilities(), nor by SolutionsParallel().
+    void SetMultiplicity(std::size_t cix, int lower, int upper) {
+        assert(cix < m_NumReqConstraints);
+        assert(0 <= lower && lower <= upper && upper >= 1);
+        assert(!m_Propagation && m_NogoodCapacity == 0 && !m_OrderedRows && m_DecompositionDepth < 0);
+        assert(m_SolutionSymmetries.empty() && m_Symmetries.empty() && m_Multiplicity.empty());
+        if (m_Bounds.empty()) {
+            m_Bounds.assign(k_HeaderSlots, 1);
+            m_Slack.assign(k_HeaderSlots, 0);
         }
+        m_Levels.resize(m_Levels.size() + upper - m_Bounds[HeaderOf(cix)]);
+        m_Bounds[HeaderOf(cix)] = upper;
+        m_Slack[HeaderOf(cix)] = upper - lower;
     }
 
-    void RemoveConstraint(int cix) { m_Headers[cix].Remove(); }
+    // The color that the selected possibilities agree on for an optional constraint, or 0 if none of them claims it
+    // with a color. Meant to be called from the print function.
+    int Color(std::size_t cix) const { return m_Colors.empty() ? 0 : m_Colors[HeaderOf(cix)]; }
+
+    // What Reduce() did to the matrix.
+    struct Reduction {
+        // Possibilities selected because some required constraint had no other, and the constraints they satisfied.
+        std::size_t forcedRows = 0;
+        std::size_t coveredColumns = 0;
+        // Possibilities removed because selecting them would leave some required constraint without possibilities.
+        std::size_t deadRows = 0;
+        // Optional constraints that no possibility claims any more.
+        std::size_t unusedColumns = 0;
+        // Some required constraint has no possibilities left, so there are no solutions.
+        bool infeasible = false;
+    };
+
+    // Simplify the matrix before searching, until nothing changes: select the only possibility of a required
+    // constraint, and remove every possibility that conflicts with all possibilities of some required constraint.
+    // Unless that shows there are no solutions, the remaining possibilities are then laid out again from scratch, in
+    // their original order, so the search runs on a smaller and denser node array. The forced possibilities are still
+    // part of every reported solution. Possibilities are numbered anew for SolutionsZdd(). If there are no solutions,
+    // every selection and removal is undone instead, leaving the matrix as it was. Call after adding every possibility
+    // and before searching. Not supported with colors or multiplicities.
+    Reduction Reduce() {
+        assert(m_Colors.empty() && m_Bounds.empty() && m_Solution.empty());
+        Reduction reduction;
+
+        const std::vector<Link> rowOf = FirstNodeOfRows();
+        std::vector<char> covered(k_HeaderSlots, 0);
+        // Every forced (true) and dead (false) row, in order, to undo them if there are no solutions.
+        std::vector<std::pair<Link, bool>> steps;
+
+        for (bool changed = true; changed && !reduction.infeasible;) {
+            changed = false;
+            for (Link h = m_Nodes[k_Root].right; h != k_Root; h = m_Nodes[h].right) {
+                if (m_Counts[h] == 0) {
+                    reduction.infeasible = true;
+                    break;
+                }
+                if (m_Counts[h] == 1) {
+                    // Selecting it changes the header list, so start over.
+                    const Link r = m_Nodes[h].down;
+                    Cover(h);
+                    Select(r);
+                    steps.emplace_back(r, true);
+                    Link j = r;
+                    do {
+                        covered[m_Nodes[j].col] = 1;
+                        ++reduction.coveredColumns;
+                        j = m_Nodes[j].right;
+                    } while (j != r);
+                    ++reduction.forcedRows;
+                    changed = true;
+                    break;
+                }
+            }
+            if (!changed && !reduction.infeasible) {
+                const std::vector<Link> dead = RemoveDeadRows(rowOf, covered);
+                for (Link r : dead) {
+                    steps.emplace_back(r, false);
+                }
+                reduction.deadRows += dead.size();
+                changed = !dead.empty();
+            }
+        }
+
+        if (reduction.infeasible) {
+            for (auto step = steps.rbegin(); step != steps.rend(); ++step) {
+                const Link r = step->first;
+                if (step->second) {
+                    UnSelect(r);
+                    UnCover(m_Nodes[r].col);
+                    continue;
+                }
+                const Link last = m_Nodes[r].left;
+                Link j = last;
+                do {
+                    RestoreNode(j);
+                    j = m_Nodes[j].left;
+                } while (j != last);
+            }
+            return reduction;
+        }
+        reduction.unusedColumns = Compact(covered);
+        return reduction;
+    }
 
     bool SanityCheck() const {
         bool noEmptyCols = true;
-        for (Node *hn = m_RootNode.right; hn != &m_RootNode; hn = hn->right) {
-            Header *h = reinterpret_cast<Header *>(hn);
-            if (h->count == 0) {
+        for (Link h = m_Nodes[k_Root].right; h != k_Root; h = m_Nodes[h].right) {
+            if (m_Counts[h] == 0) {
                 noEmptyCols = false;
-                std::cout << h->ix << ' ';
+                std::cout << ColumnIx(h) << ' ';
             }
         }
         if (!noEmptyCols) {
@@ -260,92 +860,1600 @@ public:
     }
     void PrintColCounts() const {
         int colCount = 0, total = 0;
-        for (Node *hn = m_RootNode.right; hn != &m_RootNode; hn = hn->right) {
-            Header *h = reinterpret_cast<Header *>(hn);
-            std::cout << h->ix << '\t' << h->count << '\n';
+        for (Link h = m_Nodes[k_Root].right; h != k_Root; h = m_Nodes[h].right) {
+            std::cout << ColumnIx(h) << '\t' << m_Counts[h] << '\n';
             ++colCount;
-            total += h->count;
+            total += m_Counts[h];
         }
         std::cout << "Cols  : " << colCount << '\n';
         std::cout << "Total : " << total << '\n';
     }
 
 private:
-    void Select(Node *n) {
-        m_Solution.push_back(n);
-        for (Node *j = n->right; j != n; j = j->right) {
-            j->col->Cover();
+    static constexpr Link k_Root = 0;
+    static constexpr std::size_t k_FirstNode = 1 + t_MaxConstraints;
+    // Header slots rounded up to a whole number of 64-byte vectors of counts.
+    static constexpr std::size_t k_HeaderSlots = (k_FirstNode + 15) / 16 * 16;
+    static constexpr int k_DefaultStealDepth = 8;
+    static constexpr std::size_t k_DefaultTableBytes = std::size_t{64} << 20;
+    static constexpr std::size_t k_MaxNogoodRows = 8;
+    static constexpr std::size_t k_MaxSymmetries = 256;
+
+    // State of one level of the search: the constraint being satisfied and the possibility currently selected for it
+    // (the column header itself before the first one, k_Root when choosing none). Every search steps through a level
+    // the same way: EnterColumn(), then Branch() and Unbranch() for every branch NextPossibility() moves to, then
+    // LeaveColumn(). Solutions() keeps its levels on m_Levels, the recursive searches on their own stack frames.
+    // With multiplicities also where the level's possibilities start on m_Tweaked and whether choosing none is ruled
+    // out or already tried. With propagation also where the level's entries on m_Units and its forced rows on m_Forced
+    // start, and where the entries that covering col added end.
+    struct SearchLevel {
+        Link col;
+        Link row;
+        std::uint32_t tweaked = 0;
+        bool stopped = false;
+        std::uint32_t units = 0;
+        std::uint32_t covered = 0;
+        std::uint32_t forced = 0;
+        // Under SetRandomization(): where the level's rows start on m_RowOrder, and the next one to try.
+        std::uint32_t order = 0;
+        std::uint32_t next = 0;
+    };
+
+    // Unexplored rows of one search level, shared between the owning worker (which takes them from the front) and
+    // thieves (which take them from the back).
+    struct StealableLevel {
+        std::vector<Link> rows;
+        std::size_t next = 0;
+        std::size_t end = 0;
+    };
+
+    struct Worker {
+        std::unique_ptr<ConstraintMatrix> matrix;
+        // Guards prefix, levels and publishedLevels while the worker is searching.
+        std::mutex mutex;
+        // Rows selected above the root of the current task.
+        std::vector<Link> prefix;
+        std::vector<StealableLevel> levels;
+        int publishedLevels = 0;
+        int solutions = 0;
+    };
+
+    // State of SolutionsZdd(): the ZDD so far, the constraints covered by the selected rows (one bit each), the ZDD of
+    // every subproblem solved so far by the constraints it had covered, and every branch node by its contents so that
+    // equal ones are only added once.
+    struct ZddSearch {
+        struct Hash {
+            static std::uint64_t Mix(std::uint64_t h, std::uint64_t w) {
+                h = (h ^ w) * 0x9E3779B97F4A7C15ull;
+                return h ^ (h >> 29);
+            }
+            std::size_t operator()(const std::vector<std::uint64_t> &words) const {
+                std::uint64_t h = 0;
+                for (std::uint64_t w : words) {
+                    h = Mix(h, w);
+                }
+                return static_cast<std::size_t>(h);
+            }
+            std::size_t operator()(const Zdd::Node &node) const {
+                return static_cast<std::size_t>(Mix(Mix(Mix(0, node.possibility), node.lo), node.hi));
+            }
+        };
+        struct Equal {
+            bool operator()(const Zdd::Node &a, const Zdd::Node &b) const {
+                return a.possibility == b.possibility && a.lo == b.lo && a.hi == b.hi;
+            }
+        };
+
+        Zdd::NodeIx Unique(int possibility, Zdd::NodeIx lo, Zdd::NodeIx hi) {
+            const auto [it, added] = unique.try_emplace({possibility, lo, hi}, 0);
+            if (added) {
+                it->second = zdd.Add(possibility, lo, hi);
+            }
+            return it->second;
+        }
+
+        Zdd zdd;
+        std::vector<int> possibility;
+        std::vector<std::uint64_t> covered;
+        std::unordered_map<std::vector<std::uint64_t>, Zdd::NodeIx, Hash> memo;
+        std::unordered_map<Zdd::Node, Zdd::NodeIx, Hash, Equal> unique;
+    };
+
+    struct ParallelSearch {
+        std::vector<std::unique_ptr<Worker>> workers;
+        // Number of workers holding a task. Work can only be stolen from a busy worker, so the search is over once
+        // this drops to zero.
+        std::atomic<int> busy{0};
+        int stealDepth = k_DefaultStealDepth;
+        std::mutex printMutex;
+    };
+
+    static void RunWorker(ParallelSearch &search, std::size_t self) {
+        Worker &worker = *search.workers[self];
+        ConstraintMatrix &matrix = *worker.matrix;
+        matrix.m_Instrumentation.Reset();
+
+        bool hasTask = self == 0;
+        for (;;) {
+            if (hasTask) {
+                for (Link row : worker.prefix) {
+                    matrix.Replay(row);
+                }
+                worker.solutions += matrix.SolutionsShared(worker, 0, search.stealDepth);
+                for (auto it = worker.prefix.rbegin(); it != worker.prefix.rend(); ++it) {
+                    matrix.UnReplay(*it);
+                }
+                hasTask = false;
+                search.busy.fetch_sub(1);
+            }
+
+            std::vector<Link> prefix;
+            if (TrySteal(search, self, prefix)) {
+                worker.prefix = std::move(prefix);
+                hasTask = true;
+            } else if (search.busy.load() == 0) {
+                return;
+            } else {
+                std::this_thread::yield();
+            }
         }
-        g_Instrumentation.NodeVisited();
     }
 
-    void UnSelect(Node *n) {
-        for (Node *j = n->left; j != n; j = j->left) {
-            j->col->UnCover();
+    static bool TrySteal(ParallelSearch &search, std::size_t self, std::vector<Link> &prefix) {
+        const std::size_t numWorkers = search.workers.size();
+        for (std::size_t i = 1; i < numWorkers; ++i) {
+            Worker &victim = *search.workers[(self + i) % numWorkers];
+            std::lock_guard lock(victim.mutex);
+            // Steal from the shallowest level, which has the largest subtrees.
+            for (int level = 0; level < victim.publishedLevels; ++level) {
+                StealableLevel &sl = victim.levels[level];
+                if (sl.next == sl.end) {
+                    continue;
+                }
+                prefix = victim.prefix;
+                for (int l = 0; l < level; ++l) {
+                    const StealableLevel &above = victim.levels[l];
+                    prefix.push_back(above.rows[above.next - 1]);
+                }
+                prefix.push_back(sl.rows[--sl.end]);
+                // Claimed while the victim is still busy, so busy cannot reach zero in between.
+                search.busy.fetch_add(1);
+                return true;
+            }
         }
-        m_Solution.pop_back();
+        return false;
     }
 
-    void ConnectColHeaders() {
-        // Connect root node.
-        m_RootNode.right = &m_Headers[0];
-        m_RootNode.right->left = &m_RootNode;
-        m_RootNode.left = &m_Headers[m_NumReqConstraints - 1];
-        m_RootNode.left->right = &m_RootNode;
+    // Solutions() for a worker, publishing the first stealDepth levels below the task root.
+    int SolutionsShared(Worker &worker, int level, int stealDepth) {
+        const int depth = static_cast<int>(worker.prefix.size()) + level;
+        if (level >= stealDepth) {
+            return Solutions(depth);
+        }
+        if (m_Nodes[k_Root].right == k_Root) {
+            if (!IsCanonical()) {
+                return 0;
+            }
+            PrintSolution();
+            return static_cast<int>(Copies());
+        }
 
-        for (std::size_t i = 0; i < m_NumReqConstraints; ++i) {
-            // Add rightwards connection
-            if (i < m_NumReqConstraints - 1) {
-                m_Headers[i].right = &m_Headers[i + 1];
-                m_Headers[i].right->left = &m_Headers[i];
+        m_Instrumentation.SetDepth(depth);
+        SearchLevel sl;
+        EnterColumn(sl, ChooseColumn());
+
+        StealableLevel &shared = worker.levels[level];
+        {
+            std::lock_guard lock(worker.mutex);
+            shared.rows.clear();
+            while (NextPossibility(sl)) {
+                shared.rows.push_back(sl.row);
             }
+            shared.next = 0;
+            shared.end = shared.rows.size();
+            worker.publishedLevels = level + 1;
+        }
 
-            // Connect up/down to self
-            m_Headers[i].up = &m_Headers[i];
-            m_Headers[i].down = &m_Headers[i];
+        int solutions = 0;
+        for (;;) {
+            {
+                std::lock_guard lock(worker.mutex);
+                if (shared.next == shared.end) {
+                    worker.publishedLevels = level;
+                    break;
+                }
+                sl.row = shared.rows[shared.next++];
+            }
+            if (Branch(sl)) {
+                solutions += SolutionsShared(worker, level + 1, stealDepth);
+            }
+            m_Instrumentation.SetDepth(depth);
+            Unbranch(sl);
+        }
+        LeaveColumn(sl);
 
-            // Initialize header fields
-            m_Headers[i].count = 0;
-            m_Headers[i].ix = i;
+        return solutions;
+    }
+
+    // The ZDD of the solutions of the current subproblem. Branches are built last to first, so that the hi edges are
+    // taken in the order Solutions() tries rows.
+    Zdd::NodeIx SolutionsZdd(ZddSearch &search, int depth) {
+        if (m_Nodes[k_Root].right == k_Root) {
+            return Zdd::k_Top;
+        }
+        if (const auto it = search.memo.find(search.covered); it != search.memo.end()) {
+            return it->second;
         }
 
-        for (std::size_t i = m_NumReqConstraints; i < m_NumTotalConstraints; ++i) {
-            // Connect each direction to self
-            m_Headers[i].up = &m_Headers[i];
-            m_Headers[i].down = &m_Headers[i];
-            m_Headers[i].left = &m_Headers[i];
-            m_Headers[i].right = &m_Headers[i];
-            m_Headers[i].ix = i;
+        m_Instrumentation.SetDepth(depth);
+        SearchLevel sl;
+        EnterColumn(sl, ChooseColumn());
+        std::vector<std::pair<Link, Zdd::NodeIx>> branches;
+        while (NextPossibility(sl)) {
+            if (Branch(sl)) {
+                ToggleCovered(search, sl.row);
+                const Zdd::NodeIx z = SolutionsZdd(search, depth + 1);
+                m_Instrumentation.SetDepth(depth);
+                ToggleCovered(search, sl.row);
+                if (z != Zdd::k_Bottom) {
+                    branches.emplace_back(sl.row, z);
+                }
+            }
+            Unbranch(sl);
+        }
+        LeaveColumn(sl);
+
+        Zdd::NodeIx z = Zdd::k_Bottom;
+        for (auto it = branches.rbegin(); it != branches.rend(); ++it) {
+            z = search.Unique(search.possibility[it->first - k_FirstNode], z, it->second);
         }
+        search.memo.emplace(search.covered, z);
+        return z;
+    }
+    // Flip the bits of every constraint of n's row.
+    void ToggleCovered(ZddSearch &search, Link n) const {
+        Link j = n;
+        do {
+            const std::size_t cix = ColumnIx(m_Nodes[j].col);
+            search.covered[cix / 64] ^= std::uint64_t{1} << (cix % 64);
+            j = m_Nodes[j].right;
+        } while (j != n);
     }
 
-    void PrintSolution() const {
-        if (m_PrintFunction) {
-            std::vector<std::vector<std::size_t>> selections;
-            for (const auto &node : m_Solution) {
-                selections.push_back({node->col->ix});
-                for (Node *r = node->right; r != node; r = r->right) {
-                    selections.back().push_back(r->col->ix);
+    // Whether the complete solution of the selected rows is the canonical one under m_SolutionSymmetries. A
+    // constraint's label is the smallest constraint of the row covering it, or past every header for an optional
+    // constraint left uncovered. Each permutation's image is compared label by label up to the first difference.
+    // Partial selections are not compared: a label only becomes known once its constraint is covered, so the check
+    // hardly ever cut off a branch, and it cost a comparison per node.
+    bool IsCanonical() {
+        if (m_SolutionSymmetries.empty()) {
+            return true;
+        }
+        const auto label = [&](std::vector<Link> &labels, const std::vector<Link> *image) {
+            std::fill(labels.begin(), labels.end(), static_cast<Link>(k_HeaderSlots));
+            for (Link n : m_Solution) {
+                Link smallest = static_cast<Link>(k_HeaderSlots);
+                Link j = n;
+                do {
+                    smallest = std::min(smallest, image ? (*image)[m_Nodes[j].col] : m_Nodes[j].col);
+                    j = m_Nodes[j].right;
+                } while (j != n);
+                do {
+                    labels[image ? (*image)[m_Nodes[j].col] : m_Nodes[j].col] = smallest;
+                    j = m_Nodes[j].right;
+                } while (j != n);
+            }
+        };
+        label(m_CanonicalLabels, nullptr);
+        for (const std::vector<Link> &image : m_SolutionSymmetries) {
+            label(m_ImageLabels, &image);
+            for (std::size_t c = 0; c < m_NumTotalConstraints; ++c) {
+                const Link own = m_CanonicalLabels[HeaderOf(c)];
+                const Link other = m_ImageLabels[HeaderOf(c)];
+                if (own < other) {
+                    break;
+                }
+                if (other < own) {
+                    return false;
                 }
             }
-            m_PrintFunction(selections);
         }
-        return;
+        return true;
     }
 
-private:
-    Node m_RootNode;
-    std::array<Header, t_MaxConstraints> m_Headers;
-    std::array<Node, t_MaxNodes> m_Nodes;
-    int m_NodeCount = 0;
-    // const std::size_t m_NumConstraints;
-    // const std::size_t m_OptionalConstraints;
-    
+    // Solutions() breaking the symmetries in group (indices into m_Symmetries), all of which leave the rows selected so
+    // far in place. Hands over to the plain search once no constraint is left in place by more than the identity.
+    std::uint64_t SolutionsSymmetric(const std::vector<std::uint32_t> &group, int depth) {
+        if (m_Nodes[k_Root].right == k_Root) {
+            PrintSolution();
+            return Copies();
+        }
+        // The constraint left in place by the most symmetries, then the one with the fewest possibilities.
+        Link bestCol = k_Root;
+        std::size_t bestFixed = 0;
+        for (Link h = m_Nodes[k_Root].right; h != k_Root; h = m_Nodes[h].right) {
+            const auto fixed = static_cast<std::size_t>(std::count_if(
+                group.begin(), group.end(), [&](std::uint32_t g) { return m_Symmetries[g].columns[h] == h; }));
+            if (fixed > bestFixed || (fixed == bestFixed && m_Counts[h] < m_Counts[bestCol])) {
+                bestCol = h;
+                bestFixed = fixed;
+            }
+        }
+        if (bestFixed <= 1) {
+            return static_cast<std::uint64_t>(Solutions(depth));
+        }
+        std::vector<std::uint32_t> stabilizer;
+        for (std::uint32_t g : group) {
+            if (m_Symmetries[g].columns[bestCol] == bestCol) {
+                stabilizer.push_back(g);
+            }
+        }
+
+        m_Instrumentation.SetDepth(depth);
+        SearchLevel sl;
+        EnterColumn(sl, bestCol);
+        std::uint64_t solutions = 0;
+        std::vector<std::uint32_t> orbit;
+        while (NextPossibility(sl)) {
+            const std::uint32_t row = m_SymmetryRowOf[sl.row];
+            orbit.clear();
+            for (std::uint32_t g : stabilizer) {
+                orbit.push_back(m_Symmetries[g].rows[row]);
+            }
+            std::sort(orbit.begin(), orbit.end());
+            orbit.erase(std::unique(orbit.begin(), orbit.end()), orbit.end());
+            // The orbit is searched through its first row only.
+            if (orbit.front() != row) {
+                continue;
+            }
+            std::vector<std::uint32_t> fixing;
+            for (std::uint32_t g : stabilizer) {
+                if (m_Symmetries[g].rows[row] == row) {
+                    fixing.push_back(g);
+                }
+            }
+            if (Branch(sl)) {
+                solutions += orbit.size() * SolutionsSymmetric(fixing, depth + 1);
+            }
+            m_Instrumentation.SetDepth(depth);
+            Unbranch(sl);
+        }
+        LeaveColumn(sl);
+        return solutions;
+    }
+
+    // Solutions() with decomposition, recursing once per selected row. Solutions are reported, or added to out as the
+    // rows selected below this node if it is given.
+    std::uint64_t SolutionsDecomposed(int depth, std::vector<std::vector<Link>> *out) {
+        if (m_Nodes[k_Root].right == k_Root) {
+            if (out) {
+                out->emplace_back();
+            } else {
+                PrintSolution();
+            }
+            return 1;
+        }
+        if (depth <= m_DecompositionDepth) {
+            const std::vector<std::vector<Link>> components = FindComponents();
+            if (components.size() > 1) {
+                return SolveComponents(depth, components, out);
+            }
+        }
+
+        m_Instrumentation.SetDepth(depth);
+        SearchLevel sl;
+        EnterColumn(sl, ChooseColumn());
+        std::uint64_t solutions = 0;
+        while (NextPossibility(sl)) {
+            if (Branch(sl)) {
+                const std::size_t first = out ? out->size() : 0;
+                solutions += Multiplicity(sl.row) * SolutionsDecomposed(depth + 1, out);
+                for (std::size_t i = first; out && i < out->size(); ++i) {
+                    (*out)[i].push_back(sl.row);
+                }
+            }
+            m_Instrumentation.SetDepth(depth);
+            Unbranch(sl);
+        }
+        LeaveColumn(sl);
+        return solutions;
+    }
+
+    // The headers in the header list, grouped by the parts of the matrix that live rows connect, smallest part first.
+    std::vector<std::vector<Link>> FindComponents() {
+        const std::uint32_t stamp = ++m_ComponentStamp;
+        std::vector<std::vector<Link>> components;
+        std::vector<Link> pending;
+        for (Link h = m_Nodes[k_Root].right; h != k_Root; h = m_Nodes[h].right) {
+            if (m_ComponentMarks[h] == stamp) {
+                continue;
+            }
+            m_ComponentMarks[h] = stamp;
+            components.emplace_back();
+            pending.push_back(h);
+            while (!pending.empty()) {
+                const Link c = pending.back();
+                pending.pop_back();
+                // Optional constraints (and removed ones) connect rows but are not part of the header list.
+                if (m_Active[c]) {
+                    components.back().push_back(c);
+                }
+                for (Link r = m_Nodes[c].down; r != c; r = m_Nodes[r].down) {
+                    for (Link j = m_Nodes[r].right; j != r; j = m_Nodes[j].right) {
+                        const Link col = m_Nodes[j].col;
+                        if (m_ComponentMarks[col] != stamp) {
+                            m_ComponentMarks[col] = stamp;
+                            pending.push_back(col);
+                        }
+                    }
+                }
+            }
+        }
+        std::sort(components.begin(), components.end(),
+                  [](const auto &a, const auto &b) { return a.size() < b.size(); });
+        return components;
+    }
+
+    // Solve every component with the headers of the others taken out of the header list, and combine the solutions.
+    std::uint64_t SolveComponents(int depth, const std::vector<std::vector<Link>> &components,
+                                  std::vector<std::vector<Link>> *out) {
+        ++m_Decompositions;
+        const bool collect = out || m_PrintFunction;
+        std::vector<std::vector<std::vector<Link>>> parts(components.size());
+        std::uint64_t solutions = 1;
+        for (std::size_t k = 0; k < components.size() && solutions != 0; ++k) {
+            for (std::size_t other = 0; other < components.size(); ++other) {
+                for (Link h : components[other]) {
+                    if (other != k) {
+                        RemoveHeader(h);
+                    }
+                }
+            }
+            solutions *= SolutionsDecomposed(depth, collect ? &parts[k] : nullptr);
+            for (std::size_t other = components.size(); other-- > 0;) {
+                for (auto h = components[other].rbegin(); h != components[other].rend(); ++h) {
+                    if (other != k) {
+                        RestoreHeader(*h);
+                    }
+                }
+            }
+        }
+        if (!collect || solutions == 0) {
+            return solutions;
+        }
+
+        // Every combination of one solution per part, counting through the parts like the digits of a number.
+        std::vector<std::size_t> choice(parts.size(), 0);
+        for (;;) {
+            std::vector<Link> rows;
+            for (std::size_t k = 0; k < parts.size(); ++k) {
+                rows.insert(rows.end(), parts[k][choice[k]].begin(), parts[k][choice[k]].end());
+            }
+            if (out) {
+                out->push_back(std::move(rows));
+            } else {
+                const std::size_t selected = m_Solution.size();
+                m_Solution.insert(m_Solution.end(), rows.begin(), rows.end());
+                PrintSolution();
+                m_Solution.resize(selected);
+            }
+            std::size_t k = 0;
+            while (k < parts.size() && ++choice[k] == parts[k].size()) {
+                choice[k++] = 0;
+            }
+            if (k == parts.size()) {
+                break;
+            }
+        }
+        return solutions;
+    }
+
+    // Whether the row of n is still part of the matrix during Reduce(): no node of it has been removed from its
+    // column and none of its columns has been covered.
+    bool IsLiveRow(Link n, const std::vector<char> &covered) const {
+        Link j = n;
+        do {
+            if (m_Nodes[m_Nodes[j].up].down != j || covered[m_Nodes[j].col]) {
+                return false;
+            }
+            j = m_Nodes[j].right;
+        } while (j != n);
+        return true;
+    }
+
+    // Remove every live row that conflicts with every row of some other active required column: selecting it would
+    // leave that column empty. For each row, count per column how many rows it rules out (itself included), and compare
+    // with the column's count. Returns the first nodes of the removed rows, in the order they were removed.
+    std::vector<Link> RemoveDeadRows(const std::vector<Link> &rowOf, const std::vector<char> &covered) {
+        std::vector<std::uint32_t> rowStamp(m_NodeCount, 0);
+        std::vector<std::uint32_t> colStamp(k_HeaderSlots, 0);
+        std::vector<int> ruledOut(k_HeaderSlots, 0);
+        std::vector<Link> touched;
+        std::vector<Link> dead;
+        std::uint32_t stamp = 0;
+        for (int i = 0; i < m_NodeCount; ++i) {
+            const Link r = static_cast<Link>(k_FirstNode + i);
+            if (rowOf[i] != r || !IsLiveRow(r, covered)) {
+                continue;
+            }
+            ++stamp;
+            touched.clear();
+            Link j = r;
+            do {
+                for (Link q = m_Nodes[m_Nodes[j].col].down; q != m_Nodes[j].col; q = m_Nodes[q].down) {
+                    const Link first = rowOf[q - k_FirstNode];
+                    if (rowStamp[first - k_FirstNode] == stamp) {
+                        continue;
+                    }
+                    rowStamp[first - k_FirstNode] = stamp;
+                    Link k = first;
+                    do {
+                        const Link col = m_Nodes[k].col;
+                        if (colStamp[col] != stamp) {
+                            colStamp[col] = stamp;
+                            ruledOut[col] = 0;
+                            touched.push_back(col);
+                        }
+                        ++ruledOut[col];
+                        k = m_Nodes[k].right;
+                    } while (k != first);
+                }
+                j = m_Nodes[j].right;
+            } while (j != r);
+
+            // The row's own columns lose every row too, which is fine.
+            j = r;
+            do {
+                ruledOut[m_Nodes[j].col] = -1;
+                j = m_Nodes[j].right;
+            } while (j != r);
+            for (Link col : touched) {
+                if (m_Active[col] && ruledOut[col] == m_Counts[col]) {
+                    dead.push_back(r);
+                    break;
+                }
+            }
+        }
+
+        for (Link r : dead) {
+            Link j = r;
+            do {
+                RemoveNode(j);
+                j = m_Nodes[j].right;
+            } while (j != r);
+        }
+        return dead;
+    }
+
+    // Rebuild the matrix from its live rows, keeping the rows selected so far as a fixed part of every solution.
+    // Returns how many optional columns are left without rows.
+    std::size_t Compact(const std::vector<char> &covered) {
+        for (Link n : m_Solution) {
+            m_FixedSelections.push_back({ColumnIx(m_Nodes[n].col)});
+            for (Link j = m_Nodes[n].right; j != n; j = m_Nodes[j].right) {
+                m_FixedSelections.back().push_back(ColumnIx(m_Nodes[j].col));
+            }
+            m_FixedCopies *= Multiplicity(n);
+        }
+
+        std::vector<std::size_t> offsets{0};
+        std::vector<int> constraints;
+        std::vector<std::uint32_t> multiplicities;
+        std::vector<char> used(k_HeaderSlots, 0);
+        for (int i = 0; i < m_NodeCount; ++i) {
+            const Link r = static_cast<Link>(k_FirstNode + i);
+            if (m_Nodes[r].left < r || !IsLiveRow(r, covered)) {
+                continue;
+            }
+            Link j = r;
+            do {
+                constraints.push_back(static_cast<int>(ColumnIx(m_Nodes[j].col)));
+                used[m_Nodes[j].col] = 1;
+                j = m_Nodes[j].right;
+            } while (j != r);
+            offsets.push_back(constraints.size());
+            multiplicities.push_back(static_cast<std::uint32_t>(Multiplicity(r)));
+        }
+        // Required columns that were removed before, other than by covering.
+        std::vector<Link> removed;
+        for (std::size_t c = 0; c < m_NumReqConstraints; ++c) {
+            if (!m_Active[HeaderOf(c)] && !covered[HeaderOf(c)]) {
+                removed.push_back(HeaderOf(c));
+            }
+        }
+
+        const ColumnSelection selection = m_ColumnSelection;
+        m_ColumnSelection = ColumnSelection::Scan;
+        m_Solution.clear();
+        m_NodeCount = 0;
+        m_Hash = 0;
+        ConnectColHeaders();
+        AddPossibilities(offsets, constraints);
+        if (!m_Multiplicity.empty()) {
+            std::fill(m_Multiplicity.begin(), m_Multiplicity.end(), 1);
+            Link n = static_cast<Link>(k_FirstNode);
+            for (std::size_t r = 0; r < multiplicities.size(); ++r) {
+                for (std::size_t k = offsets[r]; k < offsets[r + 1]; ++k) {
+                    m_Multiplicity[n++] = multiplicities[r];
+                }
+            }
+        }
+        for (std::size_t c = 0; c < m_NumReqConstraints; ++c) {
+            if (covered[HeaderOf(c)]) {
+                RemoveHeader(HeaderOf(c));
+            }
+        }
+        for (Link h : removed) {
+            RemoveHeader(h);
+        }
+        SetColumnSelection(selection);
+
+        std::size_t unused = 0;
+        for (std::size_t c = m_NumReqConstraints; c < m_NumTotalConstraints; ++c) {
+            unused += !used[HeaderOf(c)];
+        }
+        return unused;
+    }
+
+    // CountSolutions() below the current state. work counts the search nodes visited, including this one.
+    std::uint64_t CountSolutions(TranspositionTable &table, int depth, std::uint64_t &work) {
+        ++work;
+        if (m_Nodes[k_Root].right == k_Root) {
+            return 1;
+        }
+        if (const auto count = table.Find(m_Hash)) {
+            return *count;
+        }
+
+        const std::uint64_t workBefore = work;
+        m_Instrumentation.SetDepth(depth);
+        SearchLevel sl;
+        EnterColumn(sl, ChooseColumn());
+        std::uint64_t solutions = 0;
+        while (NextPossibility(sl)) {
+            if (Branch(sl)) {
+                solutions += Multiplicity(sl.row) * CountSolutions(table, depth + 1, work);
+            }
+            m_Instrumentation.SetDepth(depth);
+            Unbranch(sl);
+        }
+        LeaveColumn(sl);
+        table.Store(m_Hash, solutions, work - workBefore + 1);
+        return solutions;
+    }
+
+    // Reproduce the state the search is in after choosing the column of n and selecting n.
+    void Replay(Link n) {
+        Cover(m_Nodes[n].col);
+        Select(n);
+    }
+
+    void UnReplay(Link n) {
+        UnSelect(n);
+        UnCover(m_Nodes[n].col);
+    }
+
+    static constexpr Link HeaderOf(std::size_t cix) { return static_cast<Link>(cix + 1); }
+    static constexpr std::size_t ColumnIx(Link header) { return header - 1; }
+
+    // The first node of the row of every node, indexed from k_FirstNode. Left links never change and only the first
+    // node of a row links left to a node after it (or itself).
+    std::vector<Link> FirstNodeOfRows() const {
+        std::vector<Link> rowOf(m_NodeCount);
+        for (int i = 0; i < m_NodeCount; ++i) {
+            const Link n = static_cast<Link>(k_FirstNode + i);
+            rowOf[i] = m_Nodes[n].left >= n ? n : rowOf[i - 1];
+        }
+        return rowOf;
+    }
+
+    Link ChooseColumn() {
+        Link bestCol = !m_Bounds.empty()                                    ? FewestBranches()
+                       : m_Randomized                                       ? FewestPossibilitiesRandom()
+                       : m_Branching == Branching::First                    ? m_Nodes[k_Root].right
+                       : m_Branching == Branching::FailureWeighted          ? FewestPerFailure()
+                       : m_Branching != Branching::Fewest                   ? BestRanked()
+                       : m_ColumnSelection == ColumnSelection::BucketQueue ? FewestPossibilitiesBucket()
+                                                                           : FewestPossibilities();
+        assert(m_Counts[bestCol] >= 0);
+        if (m_Branching == Branching::FailureWeighted && m_Counts[bestCol] == 0) {
+            ++m_FailureWeights[bestCol];
+        }
+        return bestCol;
+    }
+
+    // The active required constraint with the lowest ratio of count to failure weight.
+    Link FewestPerFailure() const {
+        Link bestCol = k_Root;
+        std::uint64_t bestCount = 1, bestWeight = 0;
+        for (Link colH = m_Nodes[k_Root].right; colH != k_Root; colH = m_Nodes[colH].right) {
+            const std::uint64_t count = static_cast<std::uint64_t>(m_Counts[colH]);
+            if (count * bestWeight < bestCount * m_FailureWeights[colH]) {
+                bestCount = count;
+                bestWeight = m_FailureWeights[colH];
+                bestCol = colH;
+            }
+        }
+        return bestCol;
+    }
+
+    // The active required constraint that comes first by count (unless the policy is Branching::Priority) and then
+    // by m_ColumnRanks.
+    Link BestRanked() const {
+        const bool byCount = m_Branching != Branching::Priority;
+        Link bestCol = k_Root;
+        std::pair<int, int> best{std::numeric_limits<int>::max(), std::numeric_limits<int>::max()};
+        for (Link colH = m_Nodes[k_Root].right; colH != k_Root; colH = m_Nodes[colH].right) {
+            const std::pair<int, int> key{byCount ? m_Counts[colH] : 0, m_ColumnRanks[colH]};
+            if (key < best) {
+                best = key;
+                bestCol = colH;
+            }
+        }
+        return bestCol;
+    }
+
+    // The active required constraint with the lowest count, taking the leftmost one on ties. The header list is always
+    // in constraint order, so this is a min-reduction over the counts of active headers followed by a search for the
+    // first header that reaches the minimum. Inactive slots (root, covered, optional and padding) never match.
+    Link FewestPossibilities() const {
+#if defined(__AVX512F__)
+        const std::size_t end = m_NumReqConstraints + 1;
+        __m512i fewest = _mm512_set1_epi32(std::numeric_limits<int>::max());
+        for (std::size_t h = 0; h < end; h += 16) {
+            const __m512i counts = _mm512_load_si512(&m_Counts[h]);
+            const __mmask16 active = _mm512_test_epi32_mask(_mm512_load_si512(&m_Active[h]), _mm512_set1_epi32(-1));
+            fewest = _mm512_mask_min_epi32(fewest, active, fewest, counts);
+        }
+        const int minimum = _mm512_reduce_min_epi32(fewest);
+        const __m512i target = _mm512_set1_epi32(minimum);
+        for (std::size_t h = 0; h < end; h += 16) {
+            const __m512i counts = _mm512_load_si512(&m_Counts[h]);
+            const __mmask16 active = _mm512_test_epi32_mask(_mm512_load_si512(&m_Active[h]), _mm512_set1_epi32(-1));
+            const __mmask16 match = _mm512_mask_cmpeq_epi32_mask(active, counts, target);
+            if (match) {
+                return static_cast<Link>(h + __builtin_ctz(match));
+            }
+        }
+        return k_Root;
+#elif defined(__AVX2__)
+        const std::size_t end = m_NumReqConstraints + 1;
+        const __m256i inactive = _mm256_set1_epi32(std::numeric_limits<int>::max());
+        __m256i fewest = inactive;
+        for (std::size_t h = 0; h < end; h += 8) {
+            const __m256i counts = _mm256_load_si256(reinterpret_cast<const __m256i *>(&m_Counts[h]));
+            const __m256i active = _mm256_load_si256(reinterpret_cast<const __m256i *>(&m_Active[h]));
+            fewest = _mm256_min_epi32(fewest, _mm256_blendv_epi8(inactive, counts, active));
+        }
+        // Horizontal minimum of the 8 lanes.
+        fewest = _mm256_min_epi32(fewest, _mm256_permute2x128_si256(fewest, fewest, 1));
+        fewest = _mm256_min_epi32(fewest, _mm256_shuffle_epi32(fewest, _MM_SHUFFLE(1, 0, 3, 2)));
+        fewest = _mm256_min_epi32(fewest, _mm256_shuffle_epi32(fewest, _MM_SHUFFLE(2, 3, 0, 1)));
+        for (std::size_t h = 0; h < end; h += 8) {
+            const __m256i counts = _mm256_load_si256(reinterpret_cast<const __m256i *>(&m_Counts[h]));
+            const __m256i active = _mm256_load_si256(reinterpret_cast<const __m256i *>(&m_Active[h]));
+            const __m256i match = _mm256_cmpeq_epi32(_mm256_blendv_epi8(inactive, counts, active), fewest);
+            const int mask = _mm256_movemask_ps(_mm256_castsi256_ps(match));
+            if (mask) {
+                return static_cast<Link>(h + __builtin_ctz(mask));
+            }
+        }
+        return k_Root;
+#else
+        // Without vector instructions walking only the active headers beats scanning every slot.
+        Link bestCol = k_Root;
+        int fewestPossibilities = std::numeric_limits<int>::max();
+        for (Link colH = m_Nodes[k_Root].right; colH != k_Root; colH = m_Nodes[colH].right) {
+            if (m_Counts[colH] < fewestPossibilities) {
+                fewestPossibilities = m_Counts[colH];
+                bestCol = colH;
+            }
+        }
+        return bestCol;
+#endif
+    }
+
+    // Under SetRandomization(): one of the active required constraints with the lowest count, each as likely as the
+    // others.
+    Link FewestPossibilitiesRandom() {
+        Link bestCol = k_Root;
+        int fewestPossibilities = std::numeric_limits<int>::max();
+        std::uint64_t ties = 0;
+        for (Link colH = m_Nodes[k_Root].right; colH != k_Root; colH = m_Nodes[colH].right) {
+            if (m_Counts[colH] < fewestPossibilities) {
+                fewestPossibilities = m_Counts[colH];
+                bestCol = colH;
+                ties = 1;
+            } else if (m_Counts[colH] == fewestPossibilities && NextRandom() % ++ties == 0) {
+                bestCol = colH;
+            }
+        }
+        return bestCol;
+    }
+
+    // SplitMix64, so that a seed gives the same sequence everywhere.
+    std::uint64_t NextRandom() {
+        std::uint64_t z = (m_RandomState += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // The i-th term (from 1) of the Luby sequence: 1, 1, 2, 1, 1, 2, 4, 1, 1, 2, 1, 1, 2, 4, 8, ...
+    static std::uint64_t Luby(std::uint64_t i) {
+        for (;;) {
+            std::uint64_t k = 1;
+            while ((std::uint64_t{1} << k) - 1 < i) {
+                ++k;
+            }
+            if ((std::uint64_t{1} << k) - 1 == i) {
+                return std::uint64_t{1} << (k - 1);
+            }
+            i -= (std::uint64_t{1} << (k - 1)) - 1;
+        }
+    }
+
+    // One path of Estimate(): its estimates of the nodes, updates and solutions of the search. A node stands for the
+    // product of the counts of the columns branched on above it, and so do the updates made on the way to it.
+    std::array<double, 3> Probe() {
+        double weight = 1;
+        std::array<double, 3> estimate{};
+        int level = 0;
+        for (;;) {
+            if (m_Nodes[k_Root].right == k_Root) {
+                estimate[2] = weight * static_cast<double>(Copies());
+                break;
+            }
+            const Link c = ChooseColumn();
+            const int count = m_Counts[c];
+            SearchLevel &sl = m_Levels[level];
+            std::int64_t updates = m_Instrumentation.TotalUpdates();
+            EnterColumn(sl, c);
+            estimate[1] += weight * static_cast<double>(m_Instrumentation.TotalUpdates() - updates);
+            if (count == 0) {
+                LeaveColumn(sl);
+                break;
+            }
+            for (std::uint64_t k = NextRandom() % static_cast<std::uint64_t>(count); k-- > 0;) {
+                sl.row = m_Nodes[sl.row].down;
+            }
+            sl.row = m_Nodes[sl.row].down;
+            weight *= count;
+            updates = m_Instrumentation.TotalUpdates();
+            const bool consistent = Branch(sl);
+            ++level;
+            estimate[0] += weight;
+            estimate[1] += weight * static_cast<double>(m_Instrumentation.TotalUpdates() - updates);
+            if (!consistent) {
+                break;
+            }
+        }
+        Unwind(level);
+        return estimate;
+    }
+
+    // Undo the levels below level of Solutions() (whose own column has not been entered) and what they selected.
+    void Unwind(int level) {
+        while (level-- > 0) {
+            SearchLevel &sl = m_Levels[level];
+            Unbranch(sl);
+            LeaveColumn(sl);
+        }
+    }
+
+    // The first column in the lowest non-empty bucket. m_FewestBucket is only a lower bound (restoring nodes does not
+    // raise it), so climb to the first bucket that is in use.
+    Link FewestPossibilitiesBucket() {
+        while (m_BucketHeads[m_FewestBucket] == k_Root) {
+            ++m_FewestBucket;
+        }
+        return m_BucketHeads[m_FewestBucket];
+    }
+
+    void BuildBuckets() {
+        int most = 0;
+        for (Link h = m_Nodes[k_Root].right; h != k_Root; h = m_Nodes[h].right) {
+            most = std::max(most, m_Counts[h]);
+        }
+        m_BucketHeads.assign(most + 1, k_Root);
+        m_FewestBucket = most;
+        // Right to left, so that the leftmost column heads each bucket to begin with.
+        for (Link h = m_Nodes[k_Root].left; h != k_Root; h = m_Nodes[h].left) {
+            BucketInsert(h);
+        }
+    }
+
+    void BucketInsert(Link c) {
+        const Link head = m_BucketHeads[m_Counts[c]];
+        m_BucketPrev[c] = k_Root;
+        m_BucketNext[c] = head;
+        if (head != k_Root) {
+            m_BucketPrev[head] = c;
+        }
+        m_BucketHeads[m_Counts[c]] = c;
+        m_FewestBucket = std::min(m_FewestBucket, m_Counts[c]);
+    }
+    // Must be called before m_Counts[c] changes.
+    void BucketErase(Link c) {
+        const Link prev = m_BucketPrev[c];
+        const Link next = m_BucketNext[c];
+        if (prev != k_Root) {
+            m_BucketNext[prev] = next;
+        } else {
+            m_BucketHeads[m_Counts[c]] = next;
+        }
+        if (next != k_Root) {
+            m_BucketPrev[next] = prev;
+        }
+    }
+
+    // Number of selected possibilities c still needs before its lower bound is met.
+    int Needed(Link c) const { return std::max(m_Bounds[c] - m_Slack[c], 0); }
+
+    // With multiplicities: the active constraint with the fewest ways to branch on it. That is every possibility that
+    // can still be followed by enough others to reach the lower bound, plus choosing none once it is met.
+    Link FewestBranches() const {
+        Link bestCol = k_Root;
+        int fewestBranches = std::numeric_limits<int>::max();
+        for (Link colH = m_Nodes[k_Root].right; colH != k_Root; colH = m_Nodes[colH].right) {
+            const int branches = m_Counts[colH] + 1 - Needed(colH);
+            if (branches < fewestBranches) {
+                fewestBranches = branches;
+                bestCol = colH;
+            }
+        }
+        return bestCol;
+    }
+
+    void EnterColumn(SearchLevel &sl, Link c) {
+        sl = {c, c};
+        if (m_Bounds.empty()) {
+            sl.units = static_cast<std::uint32_t>(m_Units.size());
+            Cover(c);
+            sl.covered = static_cast<std::uint32_t>(m_Units.size());
+            sl.forced = static_cast<std::uint32_t>(m_Forced.size());
+            if (m_OrderedRows) {
+                OrderRows(sl);
+            }
+            return;
+        }
+        // This level uses up one more of c, or none at all. Only the last one covers c outright.
+        sl.tweaked = static_cast<std::uint32_t>(m_Tweaked.size());
+        sl.stopped = Needed(c) > 0;
+        if (--m_Bounds[c] == 0) {
+            Cover(c);
+        }
+    }
+
+    // Put the rows of sl's (just covered) column onto m_RowOrder in the order NextPossibility() is to try them,
+    // shuffled under SetRandomization() and then sorted by SetRowOrdering(), followed by the column to end the level.
+    void OrderRows(SearchLevel &sl) {
+        const Link c = sl.col;
+        sl.order = sl.next = static_cast<std::uint32_t>(m_RowOrder.size());
+        for (Link j = m_Nodes[c].down; j != c; j = m_Nodes[j].down) {
+            m_RowOrder.push_back(j);
+            if (m_Randomized) {
+                std::swap(m_RowOrder.back(), m_RowOrder[sl.order + NextRandom() % (m_RowOrder.size() - sl.order)]);
+            }
+        }
+        if (m_RowOrdering != RowOrdering::Insertion) {
+            // Lowest score first.
+            m_ScoredRows.clear();
+            for (std::size_t i = sl.order; i < m_RowOrder.size(); ++i) {
+                const Link n = m_RowOrder[i];
+                int score = 0;
+                for (Link j = m_Nodes[n].right; j != n; j = m_Nodes[j].right) {
+                    const Link col = m_Nodes[j].col;
+                    score += m_RowOrdering == RowOrdering::LeastConstraining ? m_Counts[col]
+                                                                            : -int(col <= m_NumReqConstraints);
+                }
+                m_ScoredRows.emplace_back(score, n);
+            }
+            std::stable_sort(m_ScoredRows.begin(), m_ScoredRows.end(),
+                             [](const auto &a, const auto &b) { return a.first < b.first; });
+            for (std::size_t i = 0; i < m_ScoredRows.size(); ++i) {
+                m_RowOrder[sl.order + i] = m_ScoredRows[i].second;
+            }
+        }
+        m_RowOrder.push_back(c);
+    }
+
+    // Move sl.row to the next branch of the level: a possibility, or k_Root for choosing none of them. False once
+    // every branch has been tried.
+    bool NextPossibility(SearchLevel &sl) {
+        const Link c = sl.col;
+        if (m_Bounds.empty()) {
+            sl.row = m_OrderedRows ? m_RowOrder[sl.next++] : m_Nodes[sl.row].down;
+            return sl.row != c;
+        }
+        if (sl.row == k_Root) {
+            return false;
+        }
+        const Link next = m_Nodes[sl.row].down;
+        if (m_Bounds[c] > 0) {
+            // c stays uncovered, so a possibility tried here is excluded from deeper levels (and from the later
+            // branches of this one) by hiding it and unlinking it from c, which Knuth calls tweaking. The
+            // possibilities that are left have to be able to reach the lower bound.
+            if (next != c && std::max(m_Bounds[c] + 1 - m_Slack[c], 0) <= m_Counts[c]) {
+                HideRow(next);
+                RemoveNode(next);
+                m_Tweaked.push_back(next);
+                sl.row = next;
+                return true;
+            }
+        } else if (next != c) {
+            sl.row = next;
+            return true;
+        }
+        if (sl.stopped) {
+            return false;
+        }
+        // Choose none of the remaining possibilities. All of them have been tweaked away unless c is covered.
+        sl.stopped = true;
+        sl.row = k_Root;
+        if (m_Bounds[c] > 0) {
+            RemoveHeader(c);
+        }
+        return true;
+    }
+    // Select the only possibility of every required constraint that has one left, until none has or one has none
+    // (false). The constraints to look at are on m_Units, queued by RemoveNode() as their counts dropped to one or
+    // below since sl's level was entered. Earlier ones were resolved by the levels above.
+    bool Propagate(const SearchLevel &sl) {
+        for (std::size_t i = sl.units; i < m_Units.size(); ++i) {
+            const Link c = m_Units[i];
+            if (!m_Active[c]) {
+                continue;
+            }
+            if (m_Counts[c] == 0) {
+                m_Instrumentation.Conflict();
+                if (m_Branching == Branching::FailureWeighted) {
+                    ++m_FailureWeights[c];
+                }
+                return false;
+            }
+            const Link n = m_Nodes[c].down;
+            Cover(c);
+            m_Solution.push_back(n);
+            for (Link j = m_Nodes[n].right; j != n; j = m_Nodes[j].right) {
+                Commit(j);
+            }
+            m_Forced.push_back(n);
+            m_Instrumentation.Forced();
+        }
+        return true;
+    }
+    // Undo the propagation of sl's current branch, leaving only what covering its column queued.
+    void Unpropagate(const SearchLevel &sl) {
+        while (m_Forced.size() > sl.forced) {
+            const Link n = m_Forced.back();
+            m_Forced.pop_back();
+            UnSelect(n);
+            UnCover(m_Nodes[n].col);
+        }
+        if (m_Units.size() > sl.covered) {
+            m_Units.resize(sl.covered);
+        }
+    }
+
+    // The conflict set of level: a bit per position on m_Solution.
+    std::uint64_t *LevelConflict(int level) { return &m_LevelConflicts[level * m_ConflictWords]; }
+
+    // Add to conflict the selected rows that hid possibilities of c: for each one no longer in c, a selected row that
+    // shares a constraint with it.
+    void ExplainHidden(Link c, std::uint64_t *conflict) const {
+        for (Link j : m_ColumnRows[c]) {
+            if (m_Nodes[m_Nodes[j].up].down == j) {
+                continue;
+            }
+            Link k = m_Nodes[j].right;
+            while (m_CoveredBy[m_Nodes[k].col] < 0) {
+                k = m_Nodes[k].right;
+                assert(k != j);
+            }
+            const int position = m_CoveredBy[m_Nodes[k].col];
+            conflict[position / 64] |= std::uint64_t{1} << (position % 64);
+        }
+    }
+
+    // Whether selecting n at level would complete a stored nogood. If so that nogood explains the branch's failure.
+    bool Pruned(int level, Link n) {
+        const Link row = m_RowOf[n];
+        for (std::uint32_t ix : m_NogoodWatches[row]) {
+            Nogood &nogood = m_Nogoods[ix];
+            if (std::all_of(nogood.rows.begin(), nogood.rows.end(),
+                            [&](Link r) { return r == row || m_SelectedAt[r] >= 0; })) {
+                nogood.used = true;
+                ++m_NogoodStats.pruned;
+                std::uint64_t *conflict = LevelConflict(level);
+                for (Link r : nogood.rows) {
+                    if (r != row) {
+                        conflict[m_SelectedAt[r] / 64] |= std::uint64_t{1} << (m_SelectedAt[r] % 64);
+                    }
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Every branch of level failed: store its conflict as a nogood and pass it on to the branch above, which it
+    // explains once the row selected there is taken out. Levels that never got to select a row are found again at
+    // the cost of one column choice, so their nogoods are not worth the store's space.
+    void LearnFrom(int level) {
+        std::uint64_t *conflict = LevelConflict(level);
+        ExplainHidden(m_Levels[level].col, conflict);
+        std::size_t size = 0;
+        for (std::size_t w = 0; w < m_ConflictWords; ++w) {
+            size += std::popcount(conflict[w]);
+        }
+        if (m_LevelBranched[level] && size != 0 && size <= k_MaxNogoodRows) {
+            std::vector<Link> rows;
+            for (std::size_t w = 0; w < m_ConflictWords; ++w) {
+                for (std::uint64_t bits = conflict[w]; bits != 0; bits &= bits - 1) {
+                    rows.push_back(m_RowOf[m_Solution[w * 64 + std::countr_zero(bits)]]);
+                }
+            }
+            StoreNogood(rows);
+        }
+        if (level > 0) {
+            std::uint64_t *parent = LevelConflict(level - 1);
+            for (std::size_t w = 0; w < m_ConflictWords; ++w) {
+                parent[w] |= conflict[w];
+            }
+            // The row selected above is at the top of m_Solution.
+            const std::size_t position = m_Solution.size() - 1;
+            parent[position / 64] &= ~(std::uint64_t{1} << (position % 64));
+        }
+    }
+    void StoreNogood(const std::vector<Link> &rows) {
+        std::uint32_t ix;
+        if (m_Nogoods.size() < m_NogoodCapacity) {
+            ix = static_cast<std::uint32_t>(m_Nogoods.size());
+            m_Nogoods.emplace_back();
+        } else {
+            // Second chance: skip (and age) the nogoods that pruned something since the hand last passed them.
+            while (m_Nogoods[m_NogoodHand].used) {
+                m_Nogoods[m_NogoodHand].used = false;
+                m_NogoodHand = (m_NogoodHand + 1) % m_Nogoods.size();
+            }
+            ix = static_cast<std::uint32_t>(m_NogoodHand);
+            m_NogoodHand = (m_NogoodHand + 1) % m_Nogoods.size();
+            for (Link r : m_Nogoods[ix].rows) {
+                std::vector<std::uint32_t> &watches = m_NogoodWatches[r];
+                watches.erase(std::find(watches.begin(), watches.end(), ix));
+            }
+            ++m_NogoodStats.evicted;
+        }
+        m_Nogoods[ix] = {rows, false};
+        for (Link r : rows) {
+            m_NogoodWatches[r].push_back(ix);
+        }
+        ++m_NogoodStats.learned;
+    }
+
+    void UnStop(SearchLevel &sl) {
+        if (m_Bounds[sl.col] > 0) {
+            RestoreHeader(sl.col);
+        }
+    }
+
+    // Take the branch NextPossibility() moved sl to: select its possibility (nothing when choosing none) and propagate
+    // if Solutions() is propagating. False if propagation finds a constraint that can no longer be satisfied.
+    bool Branch(SearchLevel &sl) {
+        if (sl.row != k_Root) {
+            Select(sl.row);
+        }
+        return !m_Propagating || Propagate(sl);
+    }
+
+    // Undo Branch(), whether or not it succeeded.
+    void Unbranch(SearchLevel &sl) {
+        Unpropagate(sl);
+        if (sl.row != k_Root) {
+            UnSelect(sl.row);
+        } else {
+            UnStop(sl);
+        }
+    }
+
+    void LeaveColumn(SearchLevel &sl) {
+        const Link c = sl.col;
+        if (m_Bounds.empty()) {
+            UnCover(c);
+            m_Units.resize(sl.units);
+            if (m_OrderedRows) {
+                m_RowOrder.resize(sl.order);
+            }
+            return;
+        }
+        while (m_Tweaked.size() > sl.tweaked) {
+            const Link n = m_Tweaked.back();
+            m_Tweaked.pop_back();
+            RestoreNode(n);
+            UnHideRow(n);
+        }
+        if (m_Bounds[c]++ == 0) {
+            UnCover(c);
+        }
+    }
+
+    void RemoveHeader(Link c) {
+        Node &h = m_Nodes[c];
+        m_Nodes[h.right].left = h.left;
+        m_Nodes[h.left].right = h.right;
+        if (m_ColumnSelection == ColumnSelection::BucketQueue && m_Active[c]) {
+            BucketErase(c);
+        }
+        m_Active[c] = 0;
+        m_Hash ^= m_ZobristKeys[c];
+        m_Instrumentation.Update();
+    }
+    void RestoreHeader(Link c) {
+        Node &h = m_Nodes[c];
+        m_Nodes[h.left].right = c;
+        m_Nodes[h.right].left = c;
+        m_Hash ^= m_ZobristKeys[c];
+        // Optional constraints are never in the header list.
+        if (c <= m_NumReqConstraints) {
+            m_Active[c] = -1;
+            if (m_ColumnSelection == ColumnSelection::BucketQueue) {
+                BucketInsert(c);
+            }
+        }
+    }
+
+    void RemoveNode(Link n) {
+        Node &node = m_Nodes[n];
+        m_Nodes[node.up].down = node.down;
+        m_Nodes[node.down].up = node.up;
+        const bool inBucket = m_ColumnSelection == ColumnSelection::BucketQueue && m_Active[node.col];
+        if (inBucket) {
+            BucketErase(node.col);
+        }
+        --m_Counts[node.col];
+        if (inBucket) {
+            BucketInsert(node.col);
+        }
+        if (m_Propagating && m_Counts[node.col] <= 1 && m_Active[node.col]) {
+            m_Units.push_back(node.col);
+        }
+        assert(m_Counts[node.col] >= 0);
+        m_Instrumentation.Update();
+    }
+    void RestoreNode(Link n) {
+        Node &node = m_Nodes[n];
+        const bool inBucket = m_ColumnSelection == ColumnSelection::BucketQueue && m_Active[node.col];
+        if (inBucket) {
+            BucketErase(node.col);
+        }
+        ++m_Counts[node.col];
+        if (inBucket) {
+            BucketInsert(node.col);
+        }
+        m_Nodes[node.down].up = n;
+        m_Nodes[node.up].down = n;
+    }
+
+    void Cover(Link c) {
+        // Remove c from header list
+        RemoveHeader(c);
+        // Remove all rows from c from other columns that they are in
+        for (Link i = m_Nodes[c].down; i != c; i = m_Nodes[i].down) {
+            HideRow(i);
+        }
+    }
+    void UnCover(Link c) {
+        // Reverse operation of cover
+        for (Link i = m_Nodes[c].up; i != c; i = m_Nodes[i].up) {
+            UnHideRow(i);
+        }
+        RestoreHeader(c);
+    }
+
+    // Remove the row of i from every other column it is in. Nodes already known to agree with the color of their
+    // column (-1) stay, as in Knuth's Algorithm C.
+    void HideRow(Link i) {
+        for (Link j = m_Nodes[i].right; j != i; j = m_Nodes[j].right) {
+            if (m_Colors.empty() || m_Colors[j] >= 0) {
+                RemoveNode(j);
+            }
+        }
+    }
+    void UnHideRow(Link i) {
+        for (Link j = m_Nodes[i].left; j != i; j = m_Nodes[j].left) {
+            if (m_Colors.empty() || m_Colors[j] >= 0) {
+                RestoreNode(j);
+            }
+        }
+    }
+
+    // Commit the column of n to n's color: hide every row that claims it with another color (or outright) and mark the
+    // rows with the same color as compatible.
+    void Purify(Link n) {
+        const Link c = m_Nodes[n].col;
+        const int color = m_Colors[n];
+        m_Colors[c] = color;
+        for (Link i = m_Nodes[c].down; i != c; i = m_Nodes[i].down) {
+            if (m_Colors[i] == color) {
+                if (i != n) {
+                    m_Colors[i] = -1;
+                }
+            } else {
+                HideRow(i);
+            }
+        }
+    }
+    void UnPurify(Link n) {
+        const Link c = m_Nodes[n].col;
+        const int color = m_Colors[n];
+        for (Link i = m_Nodes[c].up; i != c; i = m_Nodes[i].up) {
+            if (m_Colors[i] < 0) {
+                m_Colors[i] = color;
+            } else if (i != n) {
+                UnHideRow(i);
+            }
+        }
+        m_Colors[c] = 0;
+    }
+
+    // Claim the column of n for the selected row: cover it, or commit it to a color unless an earlier row already has.
+    // A column with multiplicities is only covered once its upper bound is used up.
+    void Commit(Link n) {
+        const int color = m_Colors.empty() ? 0 : m_Colors[n];
+        if (color == 0) {
+            const Link c = m_Nodes[n].col;
+            if (m_Bounds.empty() || --m_Bounds[c] == 0) {
+                Cover(c);
+            }
+        } else if (color > 0) {
+            Purify(n);
+        }
+    }
+    void UnCommit(Link n) {
+        const int color = m_Colors.empty() ? 0 : m_Colors[n];
+        if (color == 0) {
+            const Link c = m_Nodes[n].col;
+            if (m_Bounds.empty() || m_Bounds[c]++ == 0) {
+                UnCover(c);
+            }
+        } else if (color > 0) {
+            UnPurify(n);
+        }
+    }
+
+    void Append(Link c, Link n) {
+        // Insert node into column (at lowest position)
+        Node &h = m_Nodes[c];
+        Node &node = m_Nodes[n];
+        node.col = c;
+        node.down = c;
+        node.up = h.up;
+        m_Nodes[h.up].down = n;
+        h.up = n;
+        const bool inBucket = m_ColumnSelection == ColumnSelection::BucketQueue && m_Active[c];
+        if (inBucket) {
+            BucketErase(c);
+        }
+        ++m_Counts[c];
+        if (inBucket) {
+            if (m_Counts[c] >= static_cast<int>(m_BucketHeads.size())) {
+                m_BucketHeads.resize(m_Counts[c] + 1, k_Root);
+            }
+            BucketInsert(c);
+        }
+    }
+
+    void Select(Link n) {
+        m_Solution.push_back(n);
+        for (Link j = m_Nodes[n].right; j != n; j = m_Nodes[j].right) {
+            Commit(j);
+        }
+        if (m_NogoodCapacity != 0) {
+            MarkSelected(n, static_cast<int>(m_Solution.size()) - 1);
+        }
+        m_Instrumentation.NodeVisited();
+    }
+
+    void UnSelect(Link n) {
+        for (Link j = m_Nodes[n].left; j != n; j = m_Nodes[j].left) {
+            UnCommit(j);
+        }
+        if (m_NogoodCapacity != 0) {
+            MarkSelected(n, -1);
+        }
+        m_Solution.pop_back();
+    }
+
+    // Record n's row as selected at position of m_Solution (-1 for not selected), for it and its constraints.
+    void MarkSelected(Link n, int position) {
+        m_SelectedAt[m_RowOf[n]] = position;
+        Link j = n;
+        do {
+            m_CoveredBy[m_Nodes[j].col] = position;
+            j = m_Nodes[j].right;
+        } while (j != n);
+    }
+
+    void ConnectColHeaders() {
+        // Connect root node.
+        m_Nodes[k_Root].right = HeaderOf(0);
+        m_Nodes[k_Root].left = HeaderOf(m_NumReqConstraints - 1);
+
+        for (std::size_t i = 0; i < m_NumReqConstraints; ++i) {
+            const Link h = HeaderOf(i);
+            // Connect left & right (the root closes the list at both ends)
+            m_Nodes[h].left = i == 0 ? k_Root : HeaderOf(i - 1);
+            m_Nodes[h].right = i == m_NumReqConstraints - 1 ? k_Root : HeaderOf(i + 1);
+
+            // Connect up/down to self
+            m_Nodes[h].up = h;
+            m_Nodes[h].down = h;
+
+            // Initialize header fields
+            m_Nodes[h].col = h;
+            m_Counts[h] = 0;
+            m_Active[h] = -1;
+        }
+
+        for (std::size_t i = m_NumReqConstraints; i < m_NumTotalConstraints; ++i) {
+            // Connect each direction to self
+            const Link h = HeaderOf(i);
+            m_Nodes[h].up = h;
+            m_Nodes[h].down = h;
+            m_Nodes[h].left = h;
+            m_Nodes[h].right = h;
+            m_Nodes[h].col = h;
+            m_Counts[h] = 0;
+        }
+    }
+
+    // Reported once per combination of merged duplicates (see MergeDuplicatePossibilities()), which all look alike.
+    void PrintSolution() const {
+        if (m_PrintFunction) {
+            std::vector<std::vector<std::size_t>> selections = m_FixedSelections;
+            for (Link node : m_Solution) {
+                selections.push_back({ColumnIx(m_Nodes[node].col)});
+                for (Link r = m_Nodes[node].right; r != node; r = m_Nodes[r].right) {
+                    selections.back().push_back(ColumnIx(m_Nodes[r].col));
+                }
+            }
+            for (std::uint64_t copy = Copies(); copy-- > 1;) {
+                m_PrintFunction(selections);
+            }
+            m_PrintFunction(std::move(selections));
+        }
+        return;
+    }
+
+    // How many possibilities were merged into the one of n, itself included.
+    std::uint64_t Multiplicity(Link n) const { return m_Multiplicity.empty() ? 1 : m_Multiplicity[n]; }
+    // How many solutions the current one stands for.
+    std::uint64_t Copies() const {
+        std::uint64_t copies = m_FixedCopies;
+        if (!m_Multiplicity.empty()) {
+            for (Link node : m_Solution) {
+                copies *= m_Multiplicity[node];
+            }
+        }
+        return copies;
+    }
+
+private:
+    std::array<Node, k_FirstNode + t_MaxNodes> m_Nodes;
+    // Number of nodes in each column and whether it is in the header list (-1) or not (0), indexed by header.
+    alignas(64) std::array<int, k_HeaderSlots> m_Counts{};
+    alignas(64) std::array<int, k_HeaderSlots> m_Active{};
+
+    ColumnSelection m_ColumnSelection = ColumnSelection::Scan;
+    // SetBranching(): the policy, and the rank of every header that breaks ties under it (lowest first).
+    Branching m_Branching = Branching::Fewest;
+    std::vector<int> m_ColumnRanks;
+    std::vector<std::uint32_t> m_FailureWeights;
+    // Bucket queue: m_BucketHeads[count] is the first active column with that count and the columns of a bucket are
+    // doubly linked through m_BucketNext/m_BucketPrev, ending in k_Root. Only maintained for
+    // ColumnSelection::BucketQueue.
+    std::vector<Link> m_BucketHeads;
+    std::array<Link, k_HeaderSlots> m_BucketNext{};
+    std::array<Link, k_HeaderSlots> m_BucketPrev{};
+    int m_FewestBucket = 0;
+    // Zobrist hash of the removed headers: the XOR of their random keys, updated as they are removed and restored.
+    std::array<std::uint64_t, k_HeaderSlots> m_ZobristKeys;
+    std::uint64_t m_Hash = 0;
+    TranspositionTable::Stats m_TableStats;
+    // For SetDecompositionDepth(): the columns FindComponents() has reached, marked with the stamp of its latest call.
+    int m_DecompositionDepth = -1;
+    std::vector<std::uint32_t> m_ComponentMarks;
+    std::uint32_t m_ComponentStamp = 0;
+    std::uint64_t m_Decompositions = 0;
+    // How many possibilities each row stands for, indexed like m_Nodes, and 0 for the rows merged away. Empty until
+    // MergeDuplicatePossibilities().
+    std::vector<std::uint32_t> m_Multiplicity;
+    int m_NodeCount = 0;
+    // Color of each node, indexed like m_Nodes, and the color a header is committed to. Empty until the first colored
+    // possibility, so that matrices without colors never look at it.
+    std::vector<int> m_Colors;
+    // Multiplicities, indexed by header: how many more rows may still be selected for the column and how many of those
+    // are optional. Empty until the first SetMultiplicity(). m_Tweaked holds the rows the search has taken out of the
+    // column being branched on, for every level.
+    std::vector<int> m_Bounds;
+    std::vector<int> m_Slack;
+    std::vector<Link> m_Tweaked;
+    // For AddPossibilities(): the constraints of the possibility being added, one bit each, in debug builds.
+    std::vector<std::uint64_t> m_RowBitmap;
+    // For SetPropagation(): whether it is on, whether the running search propagates, the required constraints down to
+    // at most one possibility since they were queued, and the rows selected because they were the only ones left.
+    bool m_Propagation = false;
+    bool m_Propagating = false;
+    std::vector<Link> m_Units;
+    std::vector<Link> m_Forced;
+    // For SetRandomization() and SetFirstSolution(): the generator's state, the rows of every level in the order they
+    // are tried (see OrderRows()), the base of the restart budgets and the restarts of the last search.
+    bool m_Randomized = false;
+    std::uint64_t m_RandomState = 0;
+    std::vector<Link> m_RowOrder;
+    // For SetRowOrdering(): the order, whether levels go through m_RowOrder at all, and the rows of the level being
+    // entered with their scores.
+    RowOrdering m_RowOrdering = RowOrdering::Insertion;
+    bool m_OrderedRows = false;
+    std::vector<std::pair<int, Link>> m_ScoredRows;
+    bool m_FirstSolution = false;
+    std::uint64_t m_RestartNodes = 0;
+    std::uint64_t m_Restarts = 0;
+    // For SetNogoodLearning(): the stored nogoods as sorted first nodes of rows, and for every row the nogoods that
+    // include it. m_RowOf maps a node to the first node of its row, m_ColumnRows lists the nodes of every required
+    // column when learning was turned on, and m_CoveredBy and m_SelectedAt give the position on m_Solution of the row
+    // selected for a constraint and of a selected row. Every search level collects the positions of the rows behind
+    // its failed branches in its m_ConflictWords words of m_LevelConflicts, fails as a whole if the solution count has
+    // not moved since m_LevelSolutions, and notes in m_LevelBranched whether it selected any row.
+    struct Nogood {
+        std::vector<Link> rows;
+        // Pruned a branch since the replacement hand last passed.
+        bool used = false;
+    };
+    std::size_t m_NogoodCapacity = 0;
+    std::vector<Nogood> m_Nogoods;
+    std::size_t m_NogoodHand = 0;
+    NogoodStats m_NogoodStats;
+    std::vector<std::vector<std::uint32_t>> m_NogoodWatches;
+    std::vector<Link> m_RowOf;
+    std::vector<std::vector<Link>> m_ColumnRows;
+    std::vector<int> m_CoveredBy;
+    std::vector<int> m_SelectedAt;
+    std::size_t m_ConflictWords = 0;
+    std::vector<std::uint64_t> m_LevelConflicts;
+    std::vector<int> m_LevelSolutions;
+    std::vector<char> m_LevelBranched;
+    // For SetSolutionSymmetries(): the image of every header under each permutation other than the identity, and the
+    // labels IsCanonical() compares.
+    std::vector<std::vector<Link>> m_SolutionSymmetries;
+    std::vector<Link> m_CanonicalLabels;
+    std::vector<Link> m_ImageLabels;
+    // For DetectSymmetries(): every symmetry as the image of each header slot and of each row (numbered in
+    // m_SymmetryRows, by first node), the row number of every node, and whether Solutions() is breaking them.
+    struct Symmetry {
+        std::vector<Link> columns;
+        std::vector<std::uint32_t> rows;
+    };
+    std::vector<Symmetry> m_Symmetries;
+    std::vector<Link> m_SymmetryRows;
+    std::vector<std::uint32_t> m_SymmetryRowOf;
+    bool m_BreakingSymmetry = false;
+    // const std::size_t m_NumConstraints;
+    // const std::size_t m_OptionalConstraints;
+
     const std::size_t m_NumReqConstraints;
     const std::size_t m_NumOptConstraints;
     const std::size_t m_NumTotalConstraints;
 
-    std::vector<Node *> m_Solution;
+    std::vector<Link> m_Solution;
+    // Possibilities that Reduce() selected for good, as reported, and how many solutions they stand for.
+    std::vector<std::vector<std::size_t>> m_FixedSelections;
+    std::uint64_t m_FixedCopies = 1;
+    // Every level satisfies at least one required constraint, so the search can never be deeper than this. A
+    // constraint with multiplicities can take as many levels as its upper bound, so SetMultiplicity() adds the rest.
+    std::vector<SearchLevel> m_Levels = std::vector<SearchLevel>(t_MaxConstraints);
 
     PrintFunctionType m_PrintFunction;
+    [[no_unique_address]] t_Instrumentation m_Instrumentation;
 };
@@ -0,0 +1,463 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ConstraintMatrix.hpp"
+
+// Counts the solutions of random small matrices with every search mode and combination of modes, checks them against
+// a brute-force count, and reports every disagreement. Registered with CTest.
+
+namespace {
+
+using Matrix = ConstraintMatrix<16, 256>;
+
+// Kinds of random matrices, as bits so that a mode can name all those it supports.
+constexpr unsigned k_ExactCover = 1;
+// Some required constraints take between a lower and an upper number of possibilities (SetMultiplicity()).
+constexpr unsigned k_Multiplicities = 2;
+// Possibilities give optional constraints colors.
+constexpr unsigned k_Colored = 4;
+// Reversing the required and the optional constraints maps the possibilities onto each other.
+constexpr unsigned k_Symmetric = 8;
+// Symmetric matrices are exact cover matrices like any other.
+constexpr unsigned k_AnyExactCover = k_ExactCover | k_Symmetric;
+
+struct RandomMatrix {
+    unsigned kind = k_ExactCover;
+    std::size_t constraints = 0;
+    std::size_t optionalConstraints = 0;
+    std::vector<std::vector<int>> rows;
+    // The color of every constraint of every row, if colored.
+    std::vector<std::vector<int>> colors;
+    struct Multiplicity {
+        int constraint;
+        int lower;
+        int upper;
+    };
+    std::vector<Multiplicity> multiplicities;
+    // The identity and the reversal, if symmetric.
+    std::vector<std::vector<std::size_t>> symmetries;
+};
+
+// SplitMix64, so that every platform tests the same matrices.
+class Random {
+public:
+    explicit Random(std::uint64_t seed)
+    : m_State(seed) {}
+    std::uint64_t Next() {
+        std::uint64_t z = (m_State += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    int Below(int n) { return static_cast<int>(Next() % static_cast<std::uint64_t>(n)); }
+
+private:
+    std::uint64_t m_State;
+};
+
+// Up to 10 required and 4 optional constraints, and rows of 1-4 of them, some of them repeated. With multiplicities,
+// one or two required constraints take 0-2 to 1-3 possibilities. Colored rows give each optional constraint no color
+// or one of two. Symmetric matrices add the reversal of every row.
+RandomMatrix Generate(Random &random, unsigned kind) {
+    RandomMatrix matrix;
+    matrix.kind = kind;
+    matrix.constraints = 3 + random.Below(8);
+    matrix.optionalConstraints = random.Below(5);
+    const int total = static_cast<int>(matrix.constraints + matrix.optionalConstraints);
+    const int rows = kind == k_Symmetric ? 2 + random.Below(12) : 3 + random.Below(23);
+    for (int r = 0; r < rows; ++r) {
+        if (r > 0 && random.Below(5) == 0) {
+            const int copy = random.Below(r);
+            matrix.rows.push_back(matrix.rows[copy]);
+            if (kind == k_Colored) {
+                matrix.colors.push_back(matrix.colors[copy]);
+            }
+            continue;
+        }
+        std::vector<int> row;
+        const int size = 1 + random.Below(4);
+        for (int k = 0; k < size; ++k) {
+            const int c = random.Below(total);
+            if (std::find(row.begin(), row.end(), c) == row.end()) {
+                row.push_back(c);
+            }
+        }
+        if (kind == k_Colored) {
+            std::vector<int> colors;
+            for (int c : row) {
+                colors.push_back(c < static_cast<int>(matrix.constraints) ? 0 : random.Below(3));
+            }
+            matrix.colors.push_back(std::move(colors));
+        }
+        matrix.rows.push_back(row);
+    }
+    if (kind == k_Symmetric) {
+        std::vector<std::size_t> identity(total), reversal(total);
+        for (std::size_t c = 0; c < identity.size(); ++c) {
+            identity[c] = c;
+            reversal[c] = c < matrix.constraints ? matrix.constraints - 1 - c : matrix.constraints + (total - 1 - c);
+        }
+        for (int r = 0; r < rows; ++r) {
+            std::vector<int> image;
+            for (int c : matrix.rows[r]) {
+                image.push_back(static_cast<int>(reversal[c]));
+            }
+            matrix.rows.push_back(std::move(image));
+        }
+        matrix.symmetries = {identity, reversal};
+    }
+    if (kind == k_Multiplicities) {
+        for (int k = 1 + random.Below(2); k-- > 0;) {
+            const int lower = random.Below(3);
+            const int upper = std::max(lower, 1) + random.Below(2);
+            matrix.multiplicities.push_back({random.Below(static_cast<int>(matrix.constraints)), lower, upper});
+        }
+    }
+    return matrix;
+}
+
+std::unique_ptr<Matrix> Build(const RandomMatrix &random) {
+    auto matrix = std::make_unique<Matrix>(random.constraints, random.optionalConstraints);
+    for (std::size_t r = 0; r < random.rows.size(); ++r) {
+        matrix->AddPossibility(random.rows[r], random.colors.empty() ? std::vector<int>{} : random.colors[r]);
+    }
+    for (const RandomMatrix::Multiplicity &multiplicity : random.multiplicities) {
+        matrix->SetMultiplicity(multiplicity.constraint, multiplicity.lower, multiplicity.upper);
+    }
+    return matrix;
+}
+
+// Whether the solution of the rows selected is the smallest of its images under the matrix's symmetries, by the labels
+// SetSolutionSymmetries() compares: the smallest constraint of the row covering each constraint, or past every
+// constraint if none does.
+bool IsCanonical(const RandomMatrix &matrix, const std::vector<std::size_t> &selected) {
+    const std::size_t total = matrix.constraints + matrix.optionalConstraints;
+    const auto labels = [&](const std::vector<std::size_t> &permutation) {
+        std::vector<std::size_t> labels(total, total);
+        for (std::size_t r : selected) {
+            std::size_t smallest = total;
+            for (int c : matrix.rows[r]) {
+                smallest = std::min(smallest, permutation[c]);
+            }
+            for (int c : matrix.rows[r]) {
+                labels[permutation[c]] = smallest;
+            }
+        }
+        return labels;
+    };
+    const std::vector<std::size_t> own = labels(matrix.symmetries[0]);
+    return std::none_of(matrix.symmetries.begin(), matrix.symmetries.end(),
+                        [&](const std::vector<std::size_t> &permutation) { return labels(permutation) < own; });
+}
+
+struct Counts {
+    long long solutions = 0;
+    // The canonical ones: all of them unless the matrix is symmetric.
+    long long canonical = 0;
+};
+
+// The solutions of matrix, counted over every subset of its rows without ConstraintMatrix.
+Counts BruteForce(const RandomMatrix &matrix) {
+    const std::size_t total = matrix.constraints + matrix.optionalConstraints;
+    const std::size_t rows = matrix.rows.size();
+    std::vector<int> lower(total, 0), upper(total, 1);
+    std::fill_n(lower.begin(), matrix.constraints, 1);
+    for (const RandomMatrix::Multiplicity &multiplicity : matrix.multiplicities) {
+        lower[multiplicity.constraint] = multiplicity.lower;
+        upper[multiplicity.constraint] = multiplicity.upper;
+    }
+    // How many of the rows from r on claim each constraint, to drop subsets that can no longer reach a lower bound.
+    std::vector<std::vector<int>> later(rows + 1, std::vector<int>(total, 0));
+    for (std::size_t r = rows; r-- > 0;) {
+        later[r] = later[r + 1];
+        for (int c : matrix.rows[r]) {
+            ++later[r][c];
+        }
+    }
+    // How many selected rows claim each constraint, and the color of the first one. Rows that give a constraint the
+    // same color share it.
+    std::vector<int> claims(total, 0), shade(total, 0);
+    std::vector<std::size_t> selected;
+    Counts counts;
+    const std::function<void(std::size_t)> count = [&](std::size_t r) {
+        for (std::size_t c = 0; c < total; ++c) {
+            if (claims[c] + later[r][c] < lower[c]) {
+                return;
+            }
+        }
+        if (r == rows) {
+            ++counts.solutions;
+            counts.canonical += matrix.symmetries.empty() || IsCanonical(matrix, selected);
+            return;
+        }
+        count(r + 1);
+        const std::vector<int> &row = matrix.rows[r];
+        const auto color = [&](std::size_t k) { return matrix.colors.empty() ? 0 : matrix.colors[r][k]; };
+        // The search only selects rows through their required constraints.
+        bool required = false;
+        bool fits = true;
+        for (std::size_t k = 0; k < row.size(); ++k) {
+            required |= row[k] < static_cast<int>(matrix.constraints);
+            fits &= claims[row[k]] < upper[row[k]] || (color(k) != 0 && shade[row[k]] == color(k));
+        }
+        if (required && fits) {
+            for (std::size_t k = 0; k < row.size(); ++k) {
+                if (claims[row[k]]++ == 0) {
+                    shade[row[k]] = color(k);
+                }
+            }
+            selected.push_back(r);
+            count(r + 1);
+            selected.pop_back();
+            for (int c : row) {
+                --claims[c];
+            }
+        }
+    };
+    count(0);
+    return counts;
+}
+
+// What the result of a mode is compared with.
+enum class Expect {
+    Count, // The number of solutions.
+    Found, // 1 if there is a solution, 0 if not.
+};
+
+// Every mode: a name, what it finds, how to count with it on a freshly built matrix, the kinds of matrices it
+// supports, and whether it searches with the matrix's symmetries passed to SetSolutionSymmetries(), and so only
+// finds the canonical solutions.
+struct Mode {
+    std::string name;
+    Expect expect;
+    std::function<long long(Matrix &)> count;
+    unsigned kinds = k_AnyExactCover;
+    bool canonical = false;
+};
+
+const std::vector<Mode> &Modes() {
+    static const std::vector<Mode> modes = {
+        {"plain", Expect::Count, [](Matrix &m) { return m.Solutions(); },
+         k_AnyExactCover | k_Multiplicities | k_Colored},
+        {"bucket queue", Expect::Count,
+         [](Matrix &m) {
+             m.SetColumnSelection(Matrix::ColumnSelection::BucketQueue);
+             return m.Solutions();
+         },
+         k_AnyExactCover | k_Colored},
+        {"propagation", Expect::Count,
+         [](Matrix &m) {
+             m.SetPropagation(true);
+             return m.Solutions();
+         },
+         k_AnyExactCover | k_Colored},
+        {"merged", Expect::Count,
+         [](Matrix &m) {
+             m.MergeDuplicatePossibilities();
+             return m.Solutions();
+         },
+         k_AnyExactCover | k_Colored},
+        {"decomposed", Expect::Count,
+         [](Matrix &m) {
+             m.SetDecompositionDepth(3);
+             return m.Solutions();
+         },
+         k_AnyExactCover | k_Colored},
+        {"merged, decomposed", Expect::Count,
+         [](Matrix &m) {
+             m.MergeDuplicatePossibilities();
+             m.SetDecompositionDepth(3);
+             return m.Solutions();
+         },
+         k_AnyExactCover | k_Colored},
+        {"merged, decomposed, printed", Expect::Count,
+         [](Matrix &m) {
+             long long printed = 0;
+             m.SetPrintFunction([&](std::vector<std::vector<std::size_t>>) { ++printed; });
+             m.MergeDuplicatePossibilities();
+             m.SetDecompositionDepth(3);
+             m.Solutions();
+             return printed;
+         },
+         k_AnyExactCover | k_Colored},
+        {"parallel", Expect::Count, [](Matrix &m) { return m.SolutionsParallel(2, 2); },
+         k_AnyExactCover | k_Colored},
+        {"merged, parallel", Expect::Count,
+         [](Matrix &m) {
+             m.MergeDuplicatePossibilities();
+             return m.SolutionsParallel(2, 2);
+         },
+         k_AnyExactCover | k_Colored},
+        {"merged, decomposed, parallel", Expect::Count,
+         [](Matrix &m) {
+             m.MergeDuplicatePossibilities();
+             m.SetDecompositionDepth(3);
+             return m.SolutionsParallel(2, 2);
+         },
+         k_AnyExactCover | k_Colored},
+        {"transposition table", Expect::Count, [](Matrix &m) { return static_cast<long long>(m.CountSolutions()); }},
+        {"merged, transposition table", Expect::Count,
+         [](Matrix &m) {
+             m.MergeDuplicatePossibilities();
+             return static_cast<long long>(m.CountSolutions());
+         }},
+        {"zdd", Expect::Count, [](Matrix &m) { return static_cast<long long>(m.SolutionsZdd().Count()); }},
+        {"merged, zdd", Expect::Count,
+         [](Matrix &m) {
+             m.MergeDuplicatePossibilities();
+             return static_cast<long long>(m.SolutionsZdd().Count());
+         }},
+        {"merged, reduced, zdd", Expect::Count,
+         [](Matrix &m) {
+             m.MergeDuplicatePossibilities();
+             m.Reduce();
+             return static_cast<long long>(m.SolutionsZdd().Count());
+         }},
+        {"reduced", Expect::Count,
+         [](Matrix &m) {
+             m.Reduce();
+             return m.Solutions();
+         }},
+        {"nogoods", Expect::Count,
+         [](Matrix &m) {
+             m.SetNogoodLearning(64);
+             return m.Solutions();
+         }},
+        {"symmetries", Expect::Count,
+         [](Matrix &m) {
+             m.DetectSymmetries();
+             return m.Solutions();
+         }},
+        {"failure-weighted", Expect::Count,
+         [](Matrix &m) {
+             m.SetBranching(Matrix::Branching::FailureWeighted);
+             return m.Solutions();
+         },
+         k_AnyExactCover | k_Colored},
+        {"random, least constraining", Expect::Count,
+         [](Matrix &m) {
+             m.SetRandomization(7);
+             m.SetRowOrdering(Matrix::RowOrdering::LeastConstraining);
+             return m.Solutions();
+         },
+         k_AnyExactCover | k_Colored},
+        {"first solution", Expect::Found,
+         [](Matrix &m) {
+             m.SetFirstSolution(true);
+             return m.Solutions();
+         },
+         k_AnyExactCover | k_Multiplicities | k_Colored},
+        {"first solution with restarts", Expect::Found,
+         [](Matrix &m) {
+             m.SetFirstSolution(true, 2);
+             return m.Solutions();
+         },
+         k_AnyExactCover | k_Multiplicities | k_Colored},
+        {"merged, first solution", Expect::Found,
+         [](Matrix &m) {
+             m.MergeDuplicatePossibilities();
+             m.SetFirstSolution(true);
+             return m.Solutions();
+         },
+         k_AnyExactCover | k_Colored},
+        {"random, first solution with restarts", Expect::Found,
+         [](Matrix &m) {
+             m.SetRandomization(11);
+             m.SetFirstSolution(true, 2);
+             return m.Solutions();
+         },
+         k_AnyExactCover | k_Colored},
+        {"solution symmetries", Expect::Count, [](Matrix &m) { return m.Solutions(); }, k_Symmetric, true},
+        {"parallel, solution symmetries", Expect::Count, [](Matrix &m) { return m.SolutionsParallel(2, 2); },
+         k_Symmetric, true},
+        {"propagation, solution symmetries", Expect::Count,
+         [](Matrix &m) {
+             m.SetPropagation(true);
+             return m.Solutions();
+         },
+         k_Symmetric, true},
+        {"random, least constraining, solution symmetries", Expect::Count,
+         [](Matrix &m) {
+             m.SetRandomization(7);
+             m.SetRowOrdering(Matrix::RowOrdering::LeastConstraining);
+             return m.Solutions();
+         },
+         k_Symmetric, true},
+        {"first solution, solution symmetries", Expect::Found,
+         [](Matrix &m) {
+             m.SetFirstSolution(true);
+             return m.Solutions();
+         },
+         k_Symmetric, true},
+    };
+    return modes;
+}
+
+// Modes that only estimate the count: Estimate() must come within k_EstimateErrors standard errors of it.
+constexpr std::size_t k_EstimateSamples = 2000;
+constexpr double k_EstimateErrors = 5;
+const std::vector<std::pair<std::string, std::function<Matrix::TreeEstimate::Measure(Matrix &)>>> &Estimates() {
+    static const std::vector<std::pair<std::string, std::function<Matrix::TreeEstimate::Measure(Matrix &)>>>
+        estimates = {
+            {"estimate", [](Matrix &m) { return m.Estimate(k_EstimateSamples).solutions; }},
+            {"reduced, estimate",
+             [](Matrix &m) {
+                 m.Reduce();
+                 return m.Estimate(k_EstimateSamples).solutions;
+             }},
+        };
+    return estimates;
+}
+
+} // namespace
+
+int main() {
+    constexpr int k_Matrices = 900;
+    const std::vector<unsigned> kinds = {k_ExactCover, k_Colored, k_Symmetric,
+                                         k_ExactCover, k_Multiplicities, k_Colored};
+    Random random(2024);
+    int failures = 0;
+    for (int i = 0; i < k_Matrices; ++i) {
+        const RandomMatrix matrix = Generate(random, kinds[i % kinds.size()]);
+        const Counts expected = BruteForce(matrix);
+        for (const Mode &mode : Modes()) {
+            if (!(mode.kinds & matrix.kind)) {
+                continue;
+            }
+            const std::unique_ptr<Matrix> built = Build(matrix);
+            if (mode.canonical) {
+                built->SetSolutionSymmetries(matrix.symmetries);
+            }
+            const long long count = mode.canonical ? expected.canonical : expected.solutions;
+            const long long solutions = mode.count(*built);
+            const long long wanted = mode.expect == Expect::Found ? count > 0 : count;
+            if (solutions != wanted) {
+                std::cout << "Matrix " << i << ", " << mode.name << ": " << solutions << " solutions, expected "
+                          << wanted << '\n';
+                ++failures;
+            }
+        }
+        for (const auto &[name, estimate] : Estimates()) {
+            if (!(k_AnyExactCover & matrix.kind)) {
+                continue;
+            }
+            const Matrix::TreeEstimate::Measure solutions = estimate(*Build(matrix));
+            const double standardError = (solutions.high - solutions.mean) / 1.96;
+            const double error = std::abs(solutions.mean - static_cast<double>(expected.solutions));
+            if (error > k_EstimateErrors * standardError + 1e-9) {
+                std::cout << "Matrix " << i << ", " << name << ": " << solutions.mean << " solutions, expected "
+                          << expected.solutions << '\n';
+                ++failures;
+            }
+        }
+    }
+    std::cout << k_Matrices << " matrices, " << Modes().size() + Estimates().size() << " modes, " << failures
+              << " failures\n";
+    return failures == 0 ? 0 : 1;
+}
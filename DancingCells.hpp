@@ -0,0 +1,298 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "ConstraintMatrix.hpp"
+
+// Exact cover solver with the interface of ConstraintMatrix, using Knuth's "dancing cells" (sparse sets) instead of
+// dancing links. Every constraint (item) owns a contiguous slice of m_Set holding the nodes of its possibilities, and
+// only the first m_Size[item] of them are live. Hiding a node swaps it to the end of the live part and shrinks it, so
+// undoing work in exactly the reverse order only has to grow the sizes back. The active required constraints are a
+// sparse set of their own in m_Active.
+//
+// The search is the same as ConstraintMatrix::Solutions(), but swapping reorders the slices, so ties between columns
+// and the order in which possibilities are tried (and solutions reported) differ.
+template <std::size_t t_MaxConstraints, std::size_t t_MaxNodes, typename t_Link = std::uint32_t,
+          typename t_Instrumentation = NullInstrumentation>
+class DancingCells {
+    static_assert(std::is_unsigned_v<t_Link>, "t_Link must be an unsigned integer type");
+    static_assert(t_MaxConstraints + t_MaxNodes <= std::numeric_limits<t_Link>::max(),
+                  "t_Link is too narrow to index t_MaxConstraints + t_MaxNodes nodes");
+
+private:
+    using PrintFunctionType = std::function<void(std::vector<std::vector<std::size_t>>)>;
+
+public:
+    using Link = t_Link;
+
+    DancingCells(std::size_t constraints, std::size_t optionalConstraints = 0)
+    : m_NumReqConstraints(constraints)
+    , m_NumOptConstraints(optionalConstraints)
+    , m_NumTotalConstraints(constraints + optionalConstraints) {
+        assert(m_NumTotalConstraints <= t_MaxConstraints);
+        for (std::size_t i = 0; i < m_NumReqConstraints; ++i) {
+            m_Active[i] = static_cast<Link>(i);
+            m_ActivePos[i] = static_cast<Link>(i);
+            m_Primary[i] = true;
+        }
+        m_NumActive = m_NumReqConstraints;
+    }
+
+    void SetPrintFunction(PrintFunctionType printFunc) { m_PrintFunction = printFunc; }
+
+    // Depth-first search for every solution, on an explicit stack like ConstraintMatrix::Solutions(). depth is only
+    // used to offset the levels reported to m_Instrumentation.
+    int Solutions(int depth = 0) {
+        if (depth == 0) {
+            m_Instrumentation.Reset();
+        }
+        Prepare();
+
+        int solutions = 0;
+        int level = 0;
+        bool backtracking = false;
+        for (;;) {
+            if (!backtracking) {
+                // Check if already satisfied.
+                if (m_NumActive == 0) {
+                    PrintSolution();
+                    ++solutions;
+                    backtracking = true;
+                } else {
+                    const Link bestItem = ChooseColumn();
+                    m_Instrumentation.SetDepth(depth + level);
+                    Cover(bestItem);
+                    m_Levels[level] = {bestItem, 0};
+                }
+            }
+
+            if (backtracking) {
+                if (level == 0) {
+                    break;
+                }
+                --level;
+                m_Instrumentation.SetDepth(depth + level);
+                UnSelect(m_Set[m_Start[m_Levels[level].item] + m_Levels[level].next - 1]);
+            }
+
+            // Move on to the next possibility of this level's constraint. Its slice does not change below this level.
+            SearchLevel &sl = m_Levels[level];
+            if (sl.next == m_Size[sl.item]) {
+                UnCover(sl.item);
+                backtracking = true;
+                continue;
+            }
+            Select(m_Set[m_Start[sl.item] + sl.next++]);
+            ++level;
+            backtracking = false;
+        }
+
+        return solutions;
+    }
+
+    void AddPossibility(const std::vector<int> &constraints) {
+        assert(m_NumNodes + constraints.size() <= t_MaxNodes);
+        for (int cix : constraints) {
+            assert(cix < m_NumTotalConstraints);
+            // Check for duplicates
+            assert(std::count(constraints.begin(), constraints.end(), cix) == 1);
+            m_Item[m_NumNodes++] = static_cast<Link>(cix);
+        }
+        m_OptionStart.push_back(static_cast<Link>(m_NumNodes));
+        m_Prepared = false;
+    }
+
+    const t_Instrumentation &Instrumentation() const { return m_Instrumentation; }
+
+    // The constraint no longer has to be satisfied. Its possibilities still exclude each other, as for an optional one.
+    void RemoveConstraint(int cix) {
+        if (m_Primary[cix]) {
+            Deactivate(static_cast<Link>(cix));
+            m_Primary[cix] = false;
+        }
+    }
+
+private:
+    // State of one level of Solutions(): the constraint being satisfied and how many of its possibilities have been
+    // selected so far.
+    struct SearchLevel {
+        Link item;
+        Link next;
+    };
+
+    // Lay out the slice of every constraint once all possibilities are known.
+    void Prepare() {
+        if (m_Prepared) {
+            return;
+        }
+        std::vector<Link> counts(m_NumTotalConstraints, 0);
+        for (std::size_t n = 0; n < m_NumNodes; ++n) {
+            ++counts[m_Item[n]];
+        }
+        Link start = 0;
+        for (std::size_t i = 0; i < m_NumTotalConstraints; ++i) {
+            m_Start[i] = start;
+            m_Size[i] = 0;
+            start += counts[i];
+        }
+        // Possibilities keep the order they were added in.
+        std::size_t option = 0;
+        for (std::size_t n = 0; n < m_NumNodes; ++n) {
+            while (n == m_OptionStart[option + 1]) {
+                ++option;
+            }
+            m_Option[n] = static_cast<Link>(option);
+            const Link item = m_Item[n];
+            m_Loc[n] = m_Start[item] + m_Size[item]++;
+            m_Set[m_Loc[n]] = static_cast<Link>(n);
+        }
+        m_Prepared = true;
+    }
+
+    // The active required constraint with the fewest live possibilities.
+    Link ChooseColumn() const {
+        Link bestItem = m_Active[0];
+        for (std::size_t a = 1; a < m_NumActive; ++a) {
+            if (m_Size[m_Active[a]] < m_Size[bestItem]) {
+                bestItem = m_Active[a];
+            }
+        }
+        return bestItem;
+    }
+
+    void Deactivate(Link item) {
+        const Link last = m_Active[--m_NumActive];
+        const Link pos = m_ActivePos[item];
+        m_Active[pos] = last;
+        m_ActivePos[last] = pos;
+        m_Active[m_NumActive] = item;
+        m_ActivePos[item] = static_cast<Link>(m_NumActive);
+    }
+    // Only valid in reverse order of Deactivate(), when item is still just past the active ones.
+    void Reactivate([[maybe_unused]] Link item) {
+        assert(m_Active[m_NumActive] == item);
+        ++m_NumActive;
+    }
+
+    // Remove the other nodes of n's possibility from the live part of their constraints.
+    void Hide(Link n) {
+        const Link option = m_Option[n];
+        for (Link q = m_OptionStart[option]; q < m_OptionStart[option + 1]; ++q) {
+            if (q == n) {
+                continue;
+            }
+            const Link item = m_Item[q];
+            const Link last = m_Start[item] + --m_Size[item];
+            const Link other = m_Set[last];
+            m_Set[m_Loc[q]] = other;
+            m_Loc[other] = m_Loc[q];
+            m_Set[last] = q;
+            m_Loc[q] = last;
+            m_Instrumentation.Update();
+        }
+    }
+    void Unhide(Link n) {
+        const Link option = m_Option[n];
+        for (Link q = m_OptionStart[option + 1]; q-- > m_OptionStart[option];) {
+            if (q != n) {
+                ++m_Size[m_Item[q]];
+            }
+        }
+    }
+
+    void Cover(Link item) {
+        if (m_Primary[item]) {
+            Deactivate(item);
+        }
+        const Link start = m_Start[item];
+        for (Link k = 0; k < m_Size[item]; ++k) {
+            Hide(m_Set[start + k]);
+        }
+    }
+    void UnCover(Link item) {
+        const Link start = m_Start[item];
+        for (Link k = m_Size[item]; k-- > 0;) {
+            Unhide(m_Set[start + k]);
+        }
+        if (m_Primary[item]) {
+            Reactivate(item);
+        }
+    }
+
+    void Select(Link n) {
+        m_Solution.push_back(n);
+        const Link option = m_Option[n];
+        for (Link q = m_OptionStart[option]; q < m_OptionStart[option + 1]; ++q) {
+            if (q != n) {
+                Cover(m_Item[q]);
+            }
+        }
+        m_Instrumentation.NodeVisited();
+    }
+    void UnSelect(Link n) {
+        const Link option = m_Option[n];
+        for (Link q = m_OptionStart[option + 1]; q-- > m_OptionStart[option];) {
+            if (q != n) {
+                UnCover(m_Item[q]);
+            }
+        }
+        m_Solution.pop_back();
+    }
+
+    // Reports each selected possibility starting from the constraint it was selected for, as ConstraintMatrix does.
+    void PrintSolution() const {
+        if (m_PrintFunction) {
+            std::vector<std::vector<std::size_t>> selections;
+            for (Link n : m_Solution) {
+                const Link option = m_Option[n];
+                selections.push_back({m_Item[n]});
+                for (Link q = n + 1; q < m_OptionStart[option + 1]; ++q) {
+                    selections.back().push_back(m_Item[q]);
+                }
+                for (Link q = m_OptionStart[option]; q < n; ++q) {
+                    selections.back().push_back(m_Item[q]);
+                }
+            }
+            m_PrintFunction(selections);
+        }
+    }
+
+private:
+    const std::size_t m_NumReqConstraints;
+    const std::size_t m_NumOptConstraints;
+    const std::size_t m_NumTotalConstraints;
+
+    // The nodes of every possibility are consecutive: possibility o is m_OptionStart[o] up to m_OptionStart[o + 1].
+    std::size_t m_NumNodes = 0;
+    std::vector<Link> m_OptionStart{0};
+    std::array<Link, t_MaxNodes> m_Item;
+    std::array<Link, t_MaxNodes> m_Option;
+    // Position of each node in m_Set.
+    std::array<Link, t_MaxNodes> m_Loc;
+
+    // Built by Prepare(): the slice of m_Set for each constraint and its live length.
+    bool m_Prepared = false;
+    std::array<Link, t_MaxNodes> m_Set;
+    std::array<Link, t_MaxConstraints> m_Start;
+    std::array<Link, t_MaxConstraints> m_Size;
+
+    // The required constraints, active ones first.
+    std::array<Link, t_MaxConstraints> m_Active;
+    std::array<Link, t_MaxConstraints> m_ActivePos;
+    std::array<bool, t_MaxConstraints> m_Primary{};
+    std::size_t m_NumActive = 0;
+
+    std::vector<Link> m_Solution;
+    // Every level satisfies at least one required constraint, so the search can never be deeper than this.
+    std::array<SearchLevel, t_MaxConstraints> m_Levels;
+
+    PrintFunctionType m_PrintFunction;
+    [[no_unique_address]] t_Instrumentation m_Instrumentation;
+};
@@ -1,7 +1,7 @@
 #include <chrono>
 #include <iostream>
 
-#include "ConstraintMatrix.hpp"
+#include "BitsetMatrix.hpp"
 
 namespace {
 const int g_InitialBoard[6][7] {
@@ -39,7 +39,7 @@ const std::vector<std::vector<char>> bChar {
 // D E G
 
 // std::size_t t_Constraints, std::size_t t_Possibilities, std::size_t t_MaxConstraintsPerPossibility
-ConstraintMatrix<7, 18> g_ConstraintMatrix;
+ExactCover<7, 18> g_ConstraintMatrix(7);
 
 }
 
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// Instrumentation policies for the exact cover solvers, passed as their last template parameter. The solvers keep one
+// instance each and report to it on every search node (NodeVisited), link update (Update) and change of search depth
+// (SetDepth), and with propagation on every forced selection (Forced) and branch failed by it (Conflict). All policies
+// have the same interface, so a solver can be switched between them without other changes.
+
+// Counts nothing, every call compiles to nothing. The default.
+class NullInstrumentation {
+public:
+    void SetDepth(int) {}
+    void NodeVisited() {}
+    void Update() {}
+    void Forced() {}
+    void Conflict() {}
+    void Reset() {}
+    void Merge(const NullInstrumentation &) {}
+    void PrintResults() const {}
+    std::int64_t TotalNodes() const { return 0; }
+    std::int64_t TotalUpdates() const { return 0; }
+    std::int64_t TotalForced() const { return 0; }
+    std::int64_t TotalConflicts() const { return 0; }
+};
+
+// Total nodes visited, links updated, forced selections and conflicts.
+class CountingInstrumentation {
+public:
+    void SetDepth(int) {}
+    void NodeVisited() { ++m_NodesVisited; }
+    void Update() { ++m_Updates; }
+    void Forced() { ++m_Forced; }
+    void Conflict() { ++m_Conflicts; }
+    void Reset() {
+        m_NodesVisited = 0;
+        m_Updates = 0;
+        m_Forced = 0;
+        m_Conflicts = 0;
+    }
+    void Merge(const CountingInstrumentation &other) {
+        m_NodesVisited += other.m_NodesVisited;
+        m_Updates += other.m_Updates;
+        m_Forced += other.m_Forced;
+        m_Conflicts += other.m_Conflicts;
+    }
+    void PrintResults() const {
+        std::cout << "Nodes\tUpdates\tUpdates per Node\n";
+        std::cout << m_NodesVisited << '\t' << m_Updates << '\t' << float(m_Updates) / m_NodesVisited << '\n';
+        if (m_Forced != 0 || m_Conflicts != 0) {
+            std::cout << "Forced\t" << m_Forced << "\tConflicts\t" << m_Conflicts << '\n';
+        }
+    }
+    std::int64_t TotalNodes() const { return m_NodesVisited; }
+    std::int64_t TotalUpdates() const { return m_Updates; }
+    std::int64_t TotalForced() const { return m_Forced; }
+    std::int64_t TotalConflicts() const { return m_Conflicts; }
+
+private:
+    std::int64_t m_NodesVisited = 0;
+    std::int64_t m_Updates = 0;
+    std::int64_t m_Forced = 0;
+    std::int64_t m_Conflicts = 0;
+};
+
+// Nodes visited and links updated per search depth. Forced selections and conflicts are only totalled.
+class DetailedInstrumentation {
+public:
+    void SetDepth(int depth) {
+        m_Depth = depth;
+        if (static_cast<std::size_t>(m_Depth) + 1 > m_Updates.size()) {
+            m_Updates.resize(m_Depth + 1);
+            m_NodesVisited.resize(m_Depth + 1);
+        }
+    }
+    void NodeVisited() { ++m_NodesVisited[m_Depth]; }
+    void Update() { ++m_Updates[m_Depth]; }
+    void Forced() { ++m_Forced; }
+    void Conflict() { ++m_Conflicts; }
+    void PrintResults() const {
+        int total = 0;
+        std::int64_t total_updates = 0;
+        std::cout << "Level\tNodes\tUpdates\tUpdates per Node\n";
+        for (std::size_t i = 0; i < m_Updates.size(); ++i) {
+            std::cout << i << '\t' << m_NodesVisited[i] << '\t' << m_Updates[i] << '\t'
+                      << float(m_Updates[i]) / m_NodesVisited[i] << '\n';
+            total += m_NodesVisited[i];
+            total_updates += m_Updates[i];
+        }
+        std::cout << "Total\t" << total << '\t' << total_updates << '\t' << float(total_updates) / total << '\n';
+        if (m_Forced != 0 || m_Conflicts != 0) {
+            std::cout << "Forced\t" << m_Forced << "\tConflicts\t" << m_Conflicts << '\n';
+        }
+    }
+    void Reset() {
+        m_Depth = 0;
+        m_Updates = {0};
+        m_NodesVisited = {0};
+        m_Forced = 0;
+        m_Conflicts = 0;
+    }
+    void Merge(const DetailedInstrumentation &other) {
+        if (other.m_Updates.size() > m_Updates.size()) {
+            m_Updates.resize(other.m_Updates.size());
+            m_NodesVisited.resize(other.m_NodesVisited.size());
+        }
+        for (std::size_t i = 0; i < other.m_Updates.size(); ++i) {
+            m_Updates[i] += other.m_Updates[i];
+            m_NodesVisited[i] += other.m_NodesVisited[i];
+        }
+        m_Forced += other.m_Forced;
+        m_Conflicts += other.m_Conflicts;
+    }
+    std::int64_t TotalNodes() const {
+        std::int64_t total = 0;
+        for (int nodes : m_NodesVisited) {
+            total += nodes;
+        }
+        return total;
+    }
+    std::int64_t TotalUpdates() const {
+        std::int64_t total = 0;
+        for (std::int64_t updates : m_Updates) {
+            total += updates;
+        }
+        return total;
+    }
+    std::int64_t TotalForced() const { return m_Forced; }
+    std::int64_t TotalConflicts() const { return m_Conflicts; }
+
+private:
+    int m_Depth = 0;
+    std::vector<std::int64_t> m_Updates{0};
+    std::vector<int> m_NodesVisited{0};
+    std::int64_t m_Forced = 0;
+    std::int64_t m_Conflicts = 0;
+};
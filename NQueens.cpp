@@ -2,9 +2,11 @@
 #include <array>
 #include <chrono>
 #include <iostream>
+#include <string>
+#include <string_view>
 #include <utility>
 
-#include "ConstraintMatrix.hpp"
+#include "BitsetMatrix.hpp"
 
 namespace {
 
@@ -63,9 +65,16 @@ constexpr int ColIx(int col) {
     }
     return ix * 2 + 1;
 }
+constexpr int LineFromIx(int ix) {
+    // Inverse of the organ-pipe ordering above
+    return ix % 2 == 0 ? (k_Rows / 2) + ix / 2 : (k_Rows / 2) - (ix + 1) / 2;
+}
 constexpr std::pair<int, int> RowColFromIxs(int ix0, int ix1) {
-    // TODO - this is wrong, but will only break if we print solutions.
-    return {ix0, ix1 - k_Rows};
+    // Row constraints are the even indices, column constraints the odd ones.
+    if (ix0 % 2 != 0) {
+        std::swap(ix0, ix1);
+    }
+    return {LineFromIx(ix0 / 2), LineFromIx(ix1 / 2)};
 }
 #endif
 constexpr int DiagIxP(int row, int col) {
@@ -77,7 +86,7 @@ constexpr int DiagIxN(int row, int col) {
     return k_Rows + k_Cols + k_Diags/2 + (k_Rows-row - 1) + col;
 }
 
-void PrintFunction(std::vector<std::vector<int>> selections) {
+void PrintFunction(std::vector<std::vector<std::size_t>> selections) {
     std::cout << "Solution found :\n";
     std::array<std::array<bool, k_Cols>, k_Rows> board { false };
     for (auto & selection : selections) {
@@ -96,11 +105,21 @@ void PrintFunction(std::vector<std::vector<int>> selections) {
     std::cout << '\n';
 }
 
-ConstraintMatrix<k_Rows + k_Cols, k_Squares * 4, k_Diags> g_ConstraintMatrix;
+ExactCover<k_Rows + k_Cols + k_Diags, k_Squares * 4> g_ConstraintMatrix(k_Rows + k_Cols, k_Diags);
 
 } // namespace
 
-int main() {
+// Usage: NQueens [--print] [threads]. Searches with one worker per hardware thread unless given a thread count, and
+// with the sequential Solutions() for 1.
+int main(int argc, char **argv) {
+    unsigned threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string_view(argv[i]) == "--print") {
+            g_ConstraintMatrix.SetPrintFunction(PrintFunction);
+        } else {
+            threads = static_cast<unsigned>(std::stoul(argv[i]));
+        }
+    }
 
     // Populate constraint matrix
     for (int row = 0; row < k_Rows; ++row) {
@@ -109,11 +128,9 @@ int main() {
         }
     }
 
-    // g_ConstraintMatrix.SetPrintFunction(PrintFunction);
-
     // Solve
     const auto time_s = std::chrono::high_resolution_clock::now();
-    int solutions = g_ConstraintMatrix.Solutions();
+    int solutions = threads == 1 ? g_ConstraintMatrix.Solutions() : g_ConstraintMatrix.SolutionsParallel(threads);
     const auto time_e = std::chrono::high_resolution_clock::now();
     const auto time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(time_e - time_s).count();
     std::cout << "Found " << solutions << " possible solutions in " << time_ms << "ms\n";
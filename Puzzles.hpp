@@ -0,0 +1,419 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <numeric>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Possibility (row) generators for the puzzles in this folder, for programs that want to solve the same instances with
+// different ConstraintMatrix configurations. Required constraints are numbered first, optional ones follow.
+struct Puzzle {
+    std::string name;
+    std::size_t constraints = 0;
+    std::size_t optionalConstraints = 0;
+    std::vector<std::vector<int>> rows{};
+    // Empty, or a color for every constraint of every row (see ConstraintMatrix::AddPossibility).
+    std::vector<std::vector<int>> colors{};
+    // Required constraints that take between lower and upper possibilities instead of exactly one (see
+    // ConstraintMatrix::SetMultiplicity).
+    struct Multiplicity {
+        int constraint;
+        int lower;
+        int upper;
+    };
+    std::vector<Multiplicity> multiplicities{};
+    // Empty, or every permutation of the constraints that maps solutions to solutions, identity included (see
+    // ConstraintMatrix::SetSolutionSymmetries).
+    std::vector<std::vector<std::size_t>> symmetries{};
+
+    std::size_t Nodes() const {
+        std::size_t nodes = 0;
+        for (const auto &row : rows) {
+            nodes += row.size();
+        }
+        return nodes;
+    }
+};
+
+// The dictionary used by WordSquare.
+inline const std::vector<std::string> g_ThreeLetterWords = {
+    "ABA", "ABS", "ACE", "ACT", "ADD", "ADO", "AFT", "AGE", "AGO", "AHA", "AID", "AIM", "AIR", "ALA", "ALE", "ALL",
+    "ALT", "AMP", "ANA", "AND", "ANT", "ANY", "APE", "APP", "APT", "ARC", "ARE", "ARK", "ARM", "ART", "ASH", "ASK",
+    "ASP", "ASS", "ATE", "AVE", "AWE", "AXE", "AYE", "BAA", "BAD", "BAG", "BAN", "BAR", "BAT", "BAY", "BED", "BEE",
+    "BEG", "BEL", "BEN", "BET", "BID", "BIG", "BIN", "BIO", "BIS", "BIT", "BIZ", "BOB", "BOG", "BOO", "BOW", "BOX",
+    "BOY", "BRA", "BUD", "BUG", "BUM", "BUN", "BUS", "BUT", "BUY", "BYE", "CAB", "CAD", "CAM", "CAN", "CAP", "CAR",
+    "CAT", "CHI", "COB", "COD", "COL", "CON", "COO", "COP", "COR", "COS", "COT", "COW", "COX", "COY", "CRY", "CUB",
+    "CUE", "CUM", "CUP", "CUT", "DAB", "DAD", "DAL", "DAM", "DAN", "DAY", "DEE", "DEF", "DEL", "DEN", "DEW", "DID",
+    "DIE", "DIG", "DIM", "DIN", "DIP", "DIS", "DOC", "DOE", "DOG", "DON", "DOT", "DRY", "DUB", "DUE", "DUG", "DUN",
+    "DUO", "DYE", "EAR", "EAT", "EBB", "ECU", "EFT", "EGG", "EGO", "ELF", "ELM", "EMU", "END", "ERA", "ETA", "EVE",
+    "EYE", "FAB", "FAD", "FAN", "FAR", "FAT", "FAX", "FAY", "FED", "FEE", "FEN", "FEW", "FIG", "FIN", "FIR", "FIT",
+    "FIX", "FLU", "FLY", "FOE", "FOG", "FOR", "FOX", "FRY", "FUN", "FUR", "GAG", "GAL", "GAP", "GAS", "GAY", "GEE",
+    "GEL", "GEM", "GET", "GIG", "GIN", "GOD", "GOT", "GUM", "GUN", "GUT", "GUY", "GYM", "HAD", "HAM", "HAS", "HAT",
+    "HAY", "HEM", "HEN", "HER", "HEY", "HID", "HIM", "HIP", "HIS", "HIT", "HOG", "HON", "HOP", "HOT", "HOW", "HUB",
+    "HUE", "HUG", "HUH", "HUM", "HUT", "ICE", "ICY", "IGG", "ILL", "IMP", "INK", "INN", "ION", "ITS", "IVY", "JAM",
+    "JAR", "JAW", "JAY", "JET", "JEW", "JOB", "JOE", "JOG", "JOY", "JUG", "JUN", "KAY", "KEN", "KEY", "KID", "KIN",
+    "KIT", "LAB", "LAC", "LAD", "LAG", "LAM", "LAP", "LAW", "LAX", "LAY", "LEA", "LED", "LEE", "LEG", "LES", "LET",
+    "LIB", "LID", "LIE", "LIP", "LIT", "LOG", "LOT", "LOW", "MAC", "MAD", "MAG", "MAN", "MAP", "MAR", "MAS", "MAT",
+    "MAX", "MAY", "MED", "MEG", "MEN", "MET", "MID", "MIL", "MIX", "MOB", "MOD", "MOL", "MOM", "MON", "MOP", "MOT",
+    "MUD", "MUG", "MUM", "NAB", "NAH", "NAN", "NAP", "NAY", "NEB", "NEG", "NET", "NEW", "NIL", "NIP", "NOD", "NOR",
+    "NOS", "NOT", "NOW", "NUN", "NUT", "OAK", "ODD", "OFF", "OFT", "OIL", "OLD", "OLE", "ONE", "OOH", "OPT", "ORB",
+    "ORE", "OUR", "OUT", "OWE", "OWL", "OWN", "PAC", "PAD", "PAL", "PAM", "PAN", "PAP", "PAR", "PAS", "PAT", "PAW",
+    "PAY", "PEA", "PEG", "PEN", "PEP", "PER", "PET", "PEW", "PHI", "PIC", "PIE", "PIG", "PIN", "PIP", "PIT", "PLY",
+    "POD", "POL", "POP", "POT", "PRO", "PSI", "PUB", "PUP", "PUT", "RAD", "RAG", "RAJ", "RAM", "RAN", "RAP", "RAT",
+    "RAW", "RAY", "RED", "REF", "REG", "REM", "REP", "REV", "RIB", "RID", "RIG", "RIM", "RIP", "ROB", "ROD", "ROE",
+    "ROT", "ROW", "RUB", "RUE", "RUG", "RUM", "RUN", "RYE", "SAB", "SAC", "SAD", "SAE", "SAG", "SAL", "SAP", "SAT",
+    "SAW", "SAY", "SEA", "SEC", "SEE", "SEN", "SET", "SEW", "SEX", "SHE", "SHY", "SIC", "SIM", "SIN", "SIP", "SIR",
+    "SIS", "SIT", "SIX", "SKI", "SKY", "SLY", "SOD", "SOL", "SON", "SOW", "SOY", "SPA", "SPY", "SUB", "SUE", "SUM",
+    "SUN", "SUP", "TAB", "TAD", "TAG", "TAM", "TAN", "TAP", "TAR", "TAT", "TAX", "TEA", "TED", "TEE", "TEN", "THE",
+    "THY", "TIE", "TIN", "TIP", "TOD", "TOE", "TOM", "TON", "TOO", "TOP", "TOR", "TOT", "TOW", "TOY", "TRY", "TUB",
+    "TUG", "TWO", "USE", "VAN", "VAT", "VET", "VIA", "VIE", "VOW", "WAN", "WAR", "WAS", "WAX", "WAY", "WEB", "WED",
+    "WEE", "WET", "WHO", "WHY", "WIG", "WIN", "WIS", "WIT", "WON", "WOO", "WOW", "WRY", "WYE", "YEN", "YEP", "YES",
+    "YET", "YOU", "ZIP", "ZOO",
+};
+
+// Same encoding as Sudoku.cpp: cell, row/value, column/value and square/value constraints for every possibility, plus
+// one extra constraint per given that only the given's own possibility satisfies. '.' marks an empty cell.
+inline Puzzle SudokuPuzzle(const std::array<const char *, 9> &board) {
+    constexpr int width = 9, sWidth = 3;
+    Puzzle puzzle{"Sudoku"};
+    const auto constraints = [](int row, int col, int val) {
+        const int sqix = ((row / sWidth) * sWidth) + (col / sWidth);
+        return std::vector<int>{row * width + col, width * width + (col * width) + val,
+                                width * width * 2 + (row * width) + val, width * width * 3 + (sqix * width) + val};
+    };
+    for (int row = 0; row < width; ++row) {
+        for (int col = 0; col < width; ++col) {
+            for (int val = 0; val < width; ++val) {
+                puzzle.rows.push_back(constraints(row, col, val));
+            }
+        }
+    }
+    int initValIx = 0;
+    for (int row = 0; row < width; ++row) {
+        for (int col = 0; col < width; ++col) {
+            if (board[row][col] != '.') {
+                puzzle.rows.push_back(constraints(row, col, board[row][col] - '1'));
+                puzzle.rows.back().push_back(width * width * 4 + initValIx++);
+            }
+        }
+    }
+    puzzle.constraints = width * width * 4 + initValIx;
+    return puzzle;
+}
+
+// Every product of the generators, each a permutation of the same constraints.
+inline std::vector<std::vector<std::size_t>> GroupClosure(const std::vector<std::vector<std::size_t>> &generators) {
+    assert(!generators.empty());
+    std::vector<std::size_t> identity(generators[0].size());
+    std::iota(identity.begin(), identity.end(), std::size_t{0});
+    std::set<std::vector<std::size_t>> group{identity};
+    std::vector<std::vector<std::size_t>> pending{identity};
+    while (!pending.empty()) {
+        const std::vector<std::size_t> element = std::move(pending.back());
+        pending.pop_back();
+        for (const std::vector<std::size_t> &generator : generators) {
+            std::vector<std::size_t> product(element.size());
+            for (std::size_t c = 0; c < element.size(); ++c) {
+                product[c] = generator[element[c]];
+            }
+            if (group.insert(product).second) {
+                pending.push_back(std::move(product));
+            }
+        }
+    }
+    return {group.begin(), group.end()};
+}
+
+// One queen per row and column (required), at most one per diagonal (optional). The symmetries are the eight
+// rotations and reflections of the board.
+inline Puzzle NQueensPuzzle(int n) {
+    Puzzle puzzle{"NQueens " + std::to_string(n)};
+    const int diags = (n + n - 1) * 2;
+    puzzle.constraints = n * 2;
+    puzzle.optionalConstraints = diags;
+    for (int row = 0; row < n; ++row) {
+        for (int col = 0; col < n; ++col) {
+            puzzle.rows.push_back({row, n + col, n * 2 + row + col, n * 2 + diags / 2 + (n - row - 1) + col});
+        }
+    }
+
+    // Generated by the mirror image (col -> n - 1 - col) and the transposition (row <-> col), which both swap the
+    // diagonals going one way with those going the other.
+    std::vector<std::size_t> mirror(puzzle.constraints + puzzle.optionalConstraints);
+    std::vector<std::size_t> transpose(mirror.size());
+    for (int i = 0; i < n; ++i) {
+        mirror[i] = i;
+        mirror[n + i] = n + (n - 1 - i);
+        transpose[i] = n + i;
+        transpose[n + i] = i;
+    }
+    for (int d = 0; d < diags / 2; ++d) {
+        const int sum = n * 2 + d, difference = n * 2 + diags / 2 + d;
+        const int opposite = diags / 2 - 1 - d;
+        mirror[sum] = n * 2 + diags / 2 + opposite;
+        mirror[difference] = n * 2 + opposite;
+        transpose[sum] = sum;
+        transpose[difference] = n * 2 + diags / 2 + opposite;
+    }
+    puzzle.symmetries = GroupClosure({mirror, transpose});
+    return puzzle;
+}
+
+// The eight rotations and reflections of a polyomino, each moved to the origin. Symmetric shapes repeat.
+template <std::size_t t_Cells>
+std::vector<std::array<std::pair<int, int>, t_Cells>> Transforms(std::array<std::pair<int, int>, t_Cells> shape) {
+    std::vector<std::array<std::pair<int, int>, t_Cells>> transforms;
+    for (int flip = 0; flip < 2; ++flip) {
+        for (int rotation = 0; rotation < 4; ++rotation) {
+            for (auto &cell : shape) {
+                cell = {cell.second, -cell.first};
+            }
+            auto normalized = shape;
+            int minX = normalized[0].first, minY = normalized[0].second;
+            for (const auto &[x, y] : normalized) {
+                minX = std::min(minX, x);
+                minY = std::min(minY, y);
+            }
+            for (auto &cell : normalized) {
+                cell = {cell.first - minX, cell.second - minY};
+            }
+            std::sort(normalized.begin(), normalized.end());
+            transforms.push_back(normalized);
+        }
+        for (auto &cell : shape) {
+            cell.first = -cell.first;
+        }
+    }
+    return transforms;
+}
+
+// Every distinct fixed orientation (rotated and flipped) of a polyomino, each moved to the origin.
+template <std::size_t t_Cells>
+std::set<std::array<std::pair<int, int>, t_Cells>> FixedOrientations(std::array<std::pair<int, int>, t_Cells> shape) {
+    const auto transforms = Transforms(shape);
+    return {transforms.begin(), transforms.end()};
+}
+
+// The twelve free pentominoes on an 8x8 board without its middle 2x2 square, in every orientation and position (no
+// symmetry breaking, so every solution is found 8 times, once under each of the puzzle's symmetries). Cells are
+// constraints 0-59, pieces 60-71. With everyTransform, each of the eight rotations and reflections of a piece is placed
+// even where they coincide, which repeats the possibilities of symmetric pieces and multiplies the solutions by 1024.
+inline Puzzle PentominoPuzzle(bool everyTransform = false) {
+    using Cell = std::pair<int, int>;
+    using Shape = std::array<Cell, 5>;
+    const std::array<Shape, 12> pieces = {{
+        {{{1, 0}, {2, 0}, {0, 1}, {1, 1}, {1, 2}}}, // F
+        {{{0, 0}, {0, 1}, {0, 2}, {0, 3}, {0, 4}}}, // I
+        {{{0, 0}, {0, 1}, {0, 2}, {0, 3}, {1, 3}}}, // L
+        {{{1, 0}, {1, 1}, {0, 2}, {1, 2}, {0, 3}}}, // N
+        {{{0, 0}, {1, 0}, {0, 1}, {1, 1}, {0, 2}}}, // P
+        {{{0, 0}, {1, 0}, {2, 0}, {1, 1}, {1, 2}}}, // T
+        {{{0, 0}, {2, 0}, {0, 1}, {1, 1}, {2, 1}}}, // U
+        {{{0, 0}, {0, 1}, {0, 2}, {1, 2}, {2, 2}}}, // V
+        {{{0, 0}, {0, 1}, {1, 1}, {1, 2}, {2, 2}}}, // W
+        {{{0, 1}, {1, 0}, {1, 1}, {1, 2}, {2, 1}}}, // X
+        {{{0, 0}, {0, 1}, {0, 2}, {0, 3}, {1, 2}}}, // Y
+        {{{0, 0}, {0, 1}, {1, 1}, {2, 1}, {2, 2}}}, // Z
+    }};
+    constexpr int size = 8;
+    const auto isHole = [](int x, int y) { return (x == 3 || x == 4) && (y == 3 || y == 4); };
+
+    // Number the cells of the board.
+    std::array<std::array<int, size>, size> cellIx;
+    int cells = 0;
+    for (int x = 0; x < size; ++x) {
+        for (int y = 0; y < size; ++y) {
+            cellIx[x][y] = isHole(x, y) ? -1 : cells++;
+        }
+    }
+
+    Puzzle puzzle{everyTransform ? "Pentomino 8x8 (every transform)" : "Pentomino 8x8"};
+    puzzle.constraints = cells + pieces.size();
+    for (int p = 0; p < int(pieces.size()); ++p) {
+        const auto orientations = FixedOrientations(pieces[p]);
+        for (const auto &orientation : everyTransform ? Transforms(pieces[p])
+                                                      : std::vector<Shape>(orientations.begin(), orientations.end())) {
+            for (int x = 0; x < size; ++x) {
+                for (int y = 0; y < size; ++y) {
+                    std::vector<int> constraints;
+                    for (const auto &[cx, cy] : orientation) {
+                        if (x + cx >= size || y + cy >= size || isHole(x + cx, y + cy)) {
+                            break;
+                        }
+                        constraints.push_back(cellIx[x + cx][y + cy]);
+                    }
+                    if (constraints.size() == orientation.size()) {
+                        constraints.push_back(cells + p);
+                        puzzle.rows.push_back(constraints);
+                    }
+                }
+            }
+        }
+    }
+
+    // The board's rotations and reflections, generated by a mirror image and the transposition. Pieces stay put.
+    std::vector<std::size_t> mirror(puzzle.constraints), transpose(puzzle.constraints);
+    std::iota(mirror.begin(), mirror.end(), std::size_t{0});
+    std::iota(transpose.begin(), transpose.end(), std::size_t{0});
+    for (int x = 0; x < size; ++x) {
+        for (int y = 0; y < size; ++y) {
+            if (!isHole(x, y)) {
+                mirror[cellIx[x][y]] = cellIx[size - 1 - x][y];
+                transpose[cellIx[x][y]] = cellIx[y][x];
+            }
+        }
+    }
+    puzzle.symmetries = GroupClosure({mirror, transpose});
+    return puzzle;
+}
+
+// Same encoding as WordSquare.cpp, using the first numWords words of g_ThreeLetterWords: every word placed in each
+// row and column claims its three letters and rules out every other letter of the crossing cells.
+inline Puzzle WordSquarePuzzle(std::size_t numWords = g_ThreeLetterWords.size()) {
+    constexpr int letters = 26;
+    constexpr int vOff = letters * 3 * 3;
+    Puzzle puzzle{"WordSquare " + std::to_string(numWords)};
+    puzzle.constraints = 18 * letters;
+    for (std::size_t w = 0; w < numWords; ++w) {
+        const std::string &word = g_ThreeLetterWords[w];
+        for (int vertical = 0; vertical < 2; ++vertical) {
+            for (int line = 0; line < 3; ++line) {
+                // Cell offsets of the word's letters, and which half of the columns it claims.
+                std::array<int, 3> ix;
+                for (int i = 0; i < 3; ++i) {
+                    ix[i] = vertical ? (letters * line) + (letters * 3 * i) : (letters * 3 * line) + (letters * i);
+                }
+                const int own = vertical ? vOff : 0;
+                const int other = vertical ? 0 : vOff;
+
+                std::vector<int> constraints;
+                for (int i = 0; i < 3; ++i) {
+                    constraints.push_back(own + ix[i] + (word[i] - 'A'));
+                }
+                for (int letter = 0; letter < letters; ++letter) {
+                    for (int i = 0; i < 3; ++i) {
+                        if (letter != word[i] - 'A') {
+                            constraints.push_back(other + ix[i] + letter);
+                        }
+                    }
+                }
+                puzzle.rows.push_back(constraints);
+            }
+        }
+    }
+    return puzzle;
+}
+
+// WordSquarePuzzle with colored optional constraints: 6 required constraints (each row and each column of the grid
+// holds a word) and one optional constraint per cell, colored with the letter the word puts there. Every row has 4
+// nodes instead of 78.
+inline Puzzle WordSquareColoredPuzzle(std::size_t numWords = g_ThreeLetterWords.size()) {
+    Puzzle puzzle{"WordSquare " + std::to_string(numWords) + " (colored)"};
+    puzzle.constraints = 6;
+    puzzle.optionalConstraints = 9;
+    for (std::size_t w = 0; w < numWords; ++w) {
+        const std::string &word = g_ThreeLetterWords[w];
+        for (int vertical = 0; vertical < 2; ++vertical) {
+            for (int line = 0; line < 3; ++line) {
+                std::vector<int> constraints = {vertical * 3 + line};
+                std::vector<int> colors = {0};
+                for (int i = 0; i < 3; ++i) {
+                    const int cell = vertical ? (3 * i) + line : (3 * line) + i;
+                    constraints.push_back(6 + cell);
+                    colors.push_back(word[i] - 'A' + 1);
+                }
+                puzzle.rows.push_back(constraints);
+                puzzle.colors.push_back(colors);
+            }
+        }
+    }
+    return puzzle;
+}
+
+// Two of each of the five free tetrominoes on a 5x8 board, in every orientation and position. With multiplicities
+// there is one piece constraint per tetromino that takes exactly two possibilities. Without, the usual exact cover
+// encoding has a constraint per copy and every placement once for each copy, which finds every solution 2^5 times.
+// Cells are constraints 0-39, pieces follow.
+inline Puzzle TetrominoPairsPuzzle(bool multiplicities) {
+    using Cell = std::pair<int, int>;
+    using Shape = std::array<Cell, 4>;
+    const std::array<Shape, 5> pieces = {{
+        {{{0, 0}, {0, 1}, {0, 2}, {0, 3}}}, // I
+        {{{0, 0}, {1, 0}, {0, 1}, {1, 1}}}, // O
+        {{{0, 0}, {1, 0}, {2, 0}, {1, 1}}}, // T
+        {{{0, 0}, {0, 1}, {0, 2}, {1, 2}}}, // L
+        {{{0, 0}, {1, 0}, {1, 1}, {2, 1}}}, // S
+    }};
+    constexpr int width = 5, height = 8, copies = 2;
+    constexpr int cells = width * height;
+
+    Puzzle puzzle{multiplicities ? "Tetromino pairs 5x8 (multiplicities)" : "Tetromino pairs 5x8"};
+    puzzle.constraints = cells + pieces.size() * (multiplicities ? 1 : copies);
+    for (int p = 0; p < int(pieces.size()); ++p) {
+        if (multiplicities) {
+            puzzle.multiplicities.push_back({cells + p, copies, copies});
+        }
+        for (const auto &orientation : FixedOrientations(pieces[p])) {
+            for (int x = 0; x < width; ++x) {
+                for (int y = 0; y < height; ++y) {
+                    std::vector<int> constraints;
+                    for (const auto &[cx, cy] : orientation) {
+                        if (x + cx >= width || y + cy >= height) {
+                            break;
+                        }
+                        constraints.push_back((x + cx) * height + y + cy);
+                    }
+                    if (constraints.size() != orientation.size()) {
+                        continue;
+                    }
+                    if (multiplicities) {
+                        constraints.push_back(cells + p);
+                        puzzle.rows.push_back(constraints);
+                    } else {
+                        for (int copy = 0; copy < copies; ++copy) {
+                            constraints.push_back(cells + p * copies + copy);
+                            puzzle.rows.push_back(constraints);
+                            constraints.pop_back();
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return puzzle;
+}
+
+// Both puzzles in one matrix, with no possibility shared between them: every solution of a combined with every
+// solution of b. The constraints of b follow those of a, required and optional ones separately.
+inline Puzzle DisjointPuzzles(const Puzzle &a, const Puzzle &b) {
+    Puzzle puzzle{a.name + " + " + b.name};
+    puzzle.constraints = a.constraints + b.constraints;
+    puzzle.optionalConstraints = a.optionalConstraints + b.optionalConstraints;
+    const auto add = [&](const Puzzle &part, int reqOffset, int optOffset) {
+        for (std::size_t r = 0; r < part.rows.size(); ++r) {
+            std::vector<int> constraints;
+            for (int cix : part.rows[r]) {
+                constraints.push_back(cix + (cix < int(part.constraints) ? reqOffset : optOffset));
+            }
+            puzzle.rows.push_back(constraints);
+        }
+        for (const auto &[constraint, lower, upper] : part.multiplicities) {
+            puzzle.multiplicities.push_back({constraint + reqOffset, lower, upper});
+        }
+    };
+    add(a, 0, int(b.constraints));
+    add(b, int(a.constraints), int(a.constraints + a.optionalConstraints));
+    if (!a.colors.empty() || !b.colors.empty()) {
+        for (const Puzzle *part : {&a, &b}) {
+            for (std::size_t r = 0; r < part->rows.size(); ++r) {
+                puzzle.colors.push_back(part->colors.empty() ? std::vector<int>(part->rows[r].size(), 0)
+                                                             : part->colors[r]);
+            }
+        }
+    }
+    return puzzle;
+}
@@ -57,7 +57,7 @@ int ConstraintIxSqu(int row, int col, int val) {
     return offset + (sqix * g_Width) + val;
 }
 
-void PrintSolution(std::vector<std::vector<int>> selections) {
+void PrintSolution(std::vector<std::vector<std::size_t>> selections) {
     int board[9][9];
     for (auto &selection : selections) {
         // Figure out this possibility's row/col/val
@@ -89,7 +89,7 @@ void PrintSolution(std::vector<std::vector<int>> selections) {
 
 constexpr std::size_t g_NumConstraints = g_Width * g_Width * 4 + g_NumInitialValues;
 constexpr std::size_t g_MaxNodes = g_Width * g_Width * g_Width * 5;
-ConstraintMatrix<g_NumConstraints, g_MaxNodes> g_ConstraintMatrix;
+ConstraintMatrix<g_NumConstraints, g_MaxNodes> g_ConstraintMatrix(g_NumConstraints);
 
 } // namespace
 
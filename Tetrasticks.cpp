@@ -9,7 +9,7 @@
 #include <map>
 #include <unordered_set>
 
-#include "ConstraintMatrix.hpp"
+#include "BitsetMatrix.hpp"
 
 namespace {
 
@@ -225,7 +225,7 @@ public:
 
 struct TetrastickHash {
     std::size_t operator()(const Tetrastick &t) const {
-        std::size_t hash;
+        std::size_t hash = 0;
         for (const auto &segment : t.m_HorizontalSegments) {
             hash |= PosHash()(segment);
         }
@@ -392,9 +392,9 @@ int ConstraintIndexI(Pos segment) {
     return offset + (segment.x - 1) + (segment.y - 1) * 4;
 }
 
-ConstraintMatrix<75, 10000, 16> g_ConstraintMatrix;
+ExactCover<75 + 16, 10000> g_ConstraintMatrix(75, 16);
 
-void PrintFunction(std::vector<std::vector<int>> selections) {
+void PrintFunction(std::vector<std::vector<std::size_t>> selections) {
     std::array<std::array<int, 6>, 5> h;
     std::array<std::array<int, 5>, 6> v;
     for (auto &selection : selections) {
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Fixed-size cache of solution counts by the hash of a search state, for ConstraintMatrix::CountSolutions(). Every
+// bucket holds two entries: the first keeps whichever of its candidates took the most work to count, the second always
+// takes the latest store that did not make it into the first. Keys are 64-bit hashes and are trusted, so two states
+// with the same hash (which takes about 2^32 states to happen) share a count.
+class TranspositionTable {
+public:
+    struct Stats {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t stores = 0;
+        // Stores that overwrote the count of another state.
+        std::uint64_t evictions = 0;
+    };
+
+    // Takes as many buckets as fit in bytes, rounded down to a power of two (at least one).
+    explicit TranspositionTable(std::size_t bytes)
+    : m_Buckets(std::bit_floor(std::max<std::size_t>(bytes / sizeof(Bucket), 1)))
+    , m_Mask(m_Buckets.size() - 1) {}
+
+    std::optional<std::uint64_t> Find(std::uint64_t key) {
+        const Bucket &bucket = m_Buckets[key & m_Mask];
+        for (const Entry &entry : bucket.entries) {
+            if (entry.work != 0 && entry.key == key) {
+                ++m_Stats.hits;
+                return entry.count;
+            }
+        }
+        ++m_Stats.misses;
+        return std::nullopt;
+    }
+
+    // work is how many search nodes it took to find count, at least 1.
+    void Store(std::uint64_t key, std::uint64_t count, std::uint64_t work) {
+        const Entry entry{key, count, static_cast<std::uint32_t>(std::clamp<std::uint64_t>(work, 1, UINT32_MAX))};
+        Bucket &bucket = m_Buckets[key & m_Mask];
+        Entry &preferred = bucket.entries[0];
+        Entry &latest = bucket.entries[1];
+        ++m_Stats.stores;
+        if (preferred.work == 0 || preferred.key == key || entry.work >= preferred.work) {
+            if (preferred.work != 0 && preferred.key != key) {
+                Evict(latest, key);
+                latest = preferred;
+            }
+            preferred = entry;
+        } else {
+            Evict(latest, key);
+            latest = entry;
+        }
+    }
+
+    const Stats &GetStats() const { return m_Stats; }
+    std::size_t Bytes() const { return m_Buckets.size() * sizeof(Bucket); }
+
+private:
+    // An entry is empty while its work is 0.
+    struct Entry {
+        std::uint64_t key = 0;
+        std::uint64_t count = 0;
+        std::uint32_t work = 0;
+    };
+    struct Bucket {
+        Entry entries[2];
+    };
+
+    void Evict(const Entry &entry, std::uint64_t key) {
+        if (entry.work != 0 && entry.key != key) {
+            ++m_Stats.evictions;
+        }
+    }
+
+    std::vector<Bucket> m_Buckets;
+    std::size_t m_Mask;
+    Stats m_Stats;
+};
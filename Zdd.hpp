@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Zero-suppressed decision diagram of a set of solutions, as built by ConstraintMatrix::SolutionsZdd(). Every branch
+// node stands for one possibility (numbered in the order of AddPossibility) and every path from the root to the top
+// terminal that takes the hi edges of its nodes picks the possibilities of one solution. Nodes only ever point at
+// nodes created before them, so the solution counts are filled in bottom-up as nodes are added. A possibility that
+// merged duplicates stand for (see ConstraintMatrix::MergeDuplicatePossibilities) counts once per copy, and so do the
+// possibilities ConstraintMatrix::Reduce() fixed, which are left out of the diagram.
+//
+// Counts are 64-bit and wrap around for more than 2^64 solutions.
+class Zdd {
+public:
+    using NodeIx = std::uint32_t;
+
+    static constexpr NodeIx k_Bottom = 0;
+    static constexpr NodeIx k_Top = 1;
+
+    struct Node {
+        int possibility;
+        NodeIx lo;
+        NodeIx hi;
+    };
+
+    Zdd() = default;
+
+    std::uint64_t Count() const { return m_FixedCopies * m_Counts[m_Root]; }
+
+    // The k-th solution in the order ConstraintMatrix::Solutions() reports them, as possibility numbers. The copies of
+    // a solution have consecutive ranks and the same possibilities.
+    std::vector<int> Unrank(std::uint64_t k) const {
+        assert(k < Count());
+        k %= m_Counts[m_Root];
+        std::vector<int> solution;
+        for (NodeIx z = m_Root; z != k_Top;) {
+            const Node &node = m_Nodes[z];
+            const std::uint64_t hi = Copies(node.possibility) * m_Counts[node.hi];
+            if (k < hi) {
+                solution.push_back(node.possibility);
+                k %= m_Counts[node.hi];
+                z = node.hi;
+            } else {
+                k -= hi;
+                z = node.lo;
+            }
+        }
+        return solution;
+    }
+
+    // A solution drawn uniformly at random.
+    template <typename t_Rng>
+    std::vector<int> Sample(t_Rng &rng) const {
+        return Unrank(std::uniform_int_distribution<std::uint64_t>(0, Count() - 1)(rng));
+    }
+
+    // Branch nodes, not counting the two terminals.
+    std::size_t Nodes() const { return m_Nodes.size() - 2; }
+    std::size_t Bytes() const {
+        return m_Nodes.capacity() * sizeof(Node) + m_Counts.capacity() * sizeof(std::uint64_t);
+    }
+
+    NodeIx Root() const { return m_Root; }
+    const Node &operator[](NodeIx z) const { return m_Nodes[z]; }
+
+private:
+    template <std::size_t, std::size_t, typename, typename>
+    friend class ConstraintMatrix;
+
+    NodeIx Add(int possibility, NodeIx lo, NodeIx hi) {
+        assert(lo < m_Nodes.size() && hi < m_Nodes.size());
+        m_Nodes.push_back({possibility, lo, hi});
+        m_Counts.push_back(m_Counts[lo] + Copies(possibility) * m_Counts[hi]);
+        return static_cast<NodeIx>(m_Nodes.size() - 1);
+    }
+
+    std::uint64_t Copies(int possibility) const { return m_Copies.empty() ? 1 : m_Copies[possibility]; }
+
+    // The terminals have no possibility.
+    std::vector<Node> m_Nodes{{-1, k_Bottom, k_Bottom}, {-1, k_Top, k_Top}};
+    std::vector<std::uint64_t> m_Counts{0, 1};
+    NodeIx m_Root = k_Bottom;
+    // The copies of every possibility, or empty if there is one of each, and of the possibilities fixed beforehand.
+    std::vector<std::uint64_t> m_Copies;
+    std::uint64_t m_FixedCopies = 1;
+};
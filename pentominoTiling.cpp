@@ -7,10 +7,11 @@
 #include <iostream>
 #include <limits>
 #include <map>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 
-#include "ConstraintMatrix.hpp"
+#include "BitsetMatrix.hpp"
 
 namespace {
 struct Pos {
@@ -231,7 +232,7 @@ int ConstraintIx(const Pos &p) {
 // 12 + 60 = 72 constraints
 //      Leave in the removed 4 cells for now
 // 1568 possible placements
-ConstraintMatrix<76, 1568 * 6> g_constraintMatrix;
+ExactCover<76, 1568 * 6> g_constraintMatrix(76);
 
 // 45 Y pentominos
 // 1344 possible positions each
@@ -244,7 +245,10 @@ ConstraintMatrix<76, 1568 * 6> g_constraintMatrix;
 
 } // namespace
 
-int main() {
+// Usage: pentominoTiling [threads]. Searches with one worker per hardware thread unless given a thread count, and with
+// the sequential Solutions() for 1.
+int main(int argc, char **argv) {
+    const unsigned threads = argc > 1 ? static_cast<unsigned>(std::stoul(argv[1])) : 0;
 
     // Populate Free Pentominos map
     g_FreePentominos['F'] = Pentomino('F', {{1, 0}, {2, 0}, {0, 1}, {1, 1}, {1, 2}});
@@ -373,7 +377,7 @@ int main() {
     // Find all solutions
 
     const auto time_s = std::chrono::high_resolution_clock::now();
-    int solutions = g_constraintMatrix.Solutions();
+    int solutions = threads == 1 ? g_constraintMatrix.Solutions() : g_constraintMatrix.SolutionsParallel(threads);
     const auto time_e = std::chrono::high_resolution_clock::now();
     const auto time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(time_e - time_s).count();
     std::cout << "Found " << solutions << " possible solutions in " << time_ms << "ms\n";